@@ -0,0 +1,721 @@
+// benchmark.cpp : Benchmark of CRC-32C kernels over sizes, alignments, cache states, recorded traces, and thread counts. Prints results as JSON.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#define NOMINMAX
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "crc32c.h"
+
+/* Largest input of the size sweep. Buffer has extra room for alignment offsets. */
+#define MAX_SIZE (64 * 1024 * 1024)
+#define MAX_ALIGNMENT 64
+
+/* Warm trials repeat the call until the trial takes at least this long, so that timer overhead doesn't matter. */
+#define TRIAL_NS 20000
+
+/* Every point of the scaling benchmark runs this long. Threads walk their buffer in calls of at most this size. */
+#define SCALING_MS 200
+#define SCALING_CHUNK 65536
+
+/* DRAM working set is several times larger than LLC, but it is capped, because some VMs report huge LLC. */
+#define DRAM_MIN (64 * 1024 * 1024)
+#define DRAM_MAX (1024 * 1024 * 1024)
+
+typedef uint32_t(*kernel_function)(uint32_t, const uint8_t *, size_t);
+
+struct kernel
+{
+    const char *name;
+    kernel_function function;
+    int(*available)();
+};
+
+static int always_available() { return 1; }
+static int hybrid_available() { return crc32c_hw_available() && crc32c_clmul_available(); }
+
+static const kernel kernels[] = {
+    { "sw", crc32c_append_sw, always_available },
+    { "sw4", crc32c_append_sw4, always_available },
+    { "sw8", crc32c_append_sw8, always_available },
+    { "sw16", crc32c_append_sw16, always_available },
+    { "braided", crc32c_append_braided, always_available },
+    { "hw", crc32c_append_hw, crc32c_hw_available },
+    { "hybrid", crc32c_append_hybrid, hybrid_available },
+    { "clmul", crc32c_append_clmul, crc32c_clmul_available },
+    { "vpclmul", crc32c_append_vpclmul, crc32c_vpclmul_available },
+    { "auto", crc32c_append, always_available },
+    { "calibrated", crc32c_append_calibrated, always_available },
+};
+
+struct options
+{
+    std::vector<const kernel *> kernels;
+    size_t min_size;
+    size_t max_size;
+    int trials;
+    bool warm;
+    bool cold;
+    bool alignments;
+    const char *trace;
+    bool scaling;
+    int threads;
+    const char *output;
+};
+
+static options settings = { {}, 1, MAX_SIZE, 31, true, true, true, NULL, false, 0, NULL };
+
+/* Alignment sweep runs at these sizes: below, at, and well above the threshold of the folding kernels. */
+static const size_t alignment_sizes[] = { 16, 256, 4096 };
+
+static volatile uint32_t sink;
+
+/* Time stamp counter fenced on both sides, so that it doesn't drift into the measured code. */
+static inline uint64_t ticks()
+{
+    _mm_lfence();
+    uint64_t result = __rdtsc();
+    _mm_lfence();
+    return result;
+}
+
+static double ticks_per_ns;
+static double timer_overhead;
+
+/* Converts time stamp counter to nanoseconds by comparing it with steady_clock over a short interval. */
+static void calibrate_timer()
+{
+    auto start = std::chrono::steady_clock::now();
+    uint64_t first = ticks();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+    uint64_t last = ticks();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    ticks_per_ns = (last - first) / elapsed.count();
+    std::vector<uint64_t> empty;
+    for (int i = 0; i < 1001; ++i)
+    {
+        uint64_t before = ticks();
+        empty.push_back(ticks() - before);
+    }
+    std::sort(empty.begin(), empty.end());
+    timer_overhead = (double)empty[empty.size() / 2];
+}
+
+static void flush(const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i += 64)
+        _mm_clflush(data + i);
+    _mm_clflush(data + length - 1);
+    _mm_mfence();
+}
+
+struct stats
+{
+    double median;
+    double p99;
+};
+
+/* Nearest-rank percentiles of time per call in nanoseconds. */
+static stats summarize(std::vector<double> &samples)
+{
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    stats result;
+    result.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    result.p99 = samples[std::min(n - 1, (size_t)(0.99 * n + 0.999) - 1)];
+    return result;
+}
+
+/*
+    Times one kernel on one input. Warm trials run the input from cache, repeated after one untimed warm-up call.
+    Cold trials flush the input from all cache levels and time a single call. Calls are independent, so this is throughput.
+*/
+static stats measure(kernel_function function, const uint8_t *data, size_t size, bool cold)
+{
+    uint64_t repeats = 1;
+    if (!cold)
+    {
+        sink ^= function(0, data, size);
+        uint64_t start = ticks();
+        sink ^= function(0, data, size);
+        double once = (ticks() - start) / ticks_per_ns;
+        repeats = std::max<uint64_t>(1, (uint64_t)(TRIAL_NS / std::max(once, 1.0)));
+    }
+    std::vector<double> samples;
+    for (int trial = 0; trial < settings.trials; ++trial)
+    {
+        if (cold)
+            flush(data, size);
+        uint32_t crc = 0;
+        uint64_t start = ticks();
+        for (uint64_t i = 0; i < repeats; ++i)
+            crc ^= function(0, data, size);
+        uint64_t end = ticks();
+        sink ^= crc;
+        double elapsed = std::max(0.0, (end - start) - timer_overhead);
+        samples.push_back(elapsed / repeats / ticks_per_ns);
+    }
+    return summarize(samples);
+}
+
+static FILE *output;
+static bool first_result = true;
+
+static void report(const kernel *k, bool cold, size_t size, size_t alignment, stats result)
+{
+    fprintf(output, "%s\n    { \"kernel\": \"%s\", \"cache\": \"%s\", \"size\": %zu, \"alignment\": %zu, "
+        "\"median_ns\": %.2f, \"p99_ns\": %.2f, \"median_gbps\": %.3f, \"median_tsc_per_byte\": %.4f }",
+        first_result ? "" : ",", k->name, cold ? "cold" : "warm", size, alignment,
+        result.median, result.p99, size / std::max(result.median, 0.001), result.median * ticks_per_ns / size);
+    first_result = false;
+}
+
+/* Size sweep followed by alignment sweep in every selected cache state. */
+static void sweep(const kernel *k, const uint8_t *data)
+{
+    for (int cold = 0; cold < 2; ++cold)
+    {
+        if (cold ? !settings.cold : !settings.warm)
+            continue;
+        for (size_t size = settings.min_size; size <= settings.max_size; size *= 2)
+            report(k, cold != 0, size, 0, measure(k->function, data, size, cold != 0));
+        if (!settings.alignments)
+            continue;
+        /* alignment 0 is already covered by the size sweep */
+        for (size_t size : alignment_sizes)
+        {
+            for (size_t alignment = 1; alignment < MAX_ALIGNMENT; ++alignment)
+                report(k, cold != 0, size, alignment, measure(k->function, data + alignment, size, cold != 0));
+        }
+    }
+}
+
+/* One recorded call. Input pointer is assigned after the whole trace is loaded. */
+struct trace_call
+{
+    size_t length;
+    size_t alignment;
+    bool reuse;
+    const uint8_t *input;
+};
+
+/*
+    Reads trace with one call per line: length, alignment (offset from 64-byte boundary), and reuse flag.
+    Reused calls start in the same cache line as the previous call, so their input is mostly in cache. Other calls read the next
+    region of the 64MB buffer, which is flushed from all cache levels before every pass. Lines starting with # are comments.
+*/
+static bool load_trace(const char *path, std::vector<trace_call> &calls)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "crc32c-bench: %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    char line[256];
+    for (int number = 1; fgets(line, sizeof(line), file); ++number)
+    {
+        char *start = line + strspn(line, " \t");
+        if (*start == '#' || *start == '\n' || *start == '\r' || !*start)
+            continue;
+        unsigned long long length, alignment;
+        int reuse;
+        if (sscanf(start, "%llu %llu %d", &length, &alignment, &reuse) != 3 || length > MAX_SIZE || alignment >= MAX_ALIGNMENT)
+        {
+            fprintf(stderr, "crc32c-bench: %s:%d: expected length up to 64MB, alignment 0-63, and reuse flag\n", path, number);
+            fclose(file);
+            return false;
+        }
+        trace_call call = { (size_t)length, (size_t)alignment, reuse != 0, NULL };
+        calls.push_back(call);
+    }
+    fclose(file);
+    if (calls.empty())
+    {
+        fprintf(stderr, "crc32c-bench: %s: trace is empty\n", path);
+        return false;
+    }
+    return true;
+}
+
+/* Places calls in the buffer, so that replay only has to make the calls. */
+static void place_trace(std::vector<trace_call> &calls, const uint8_t *data)
+{
+    size_t cursor = 0;
+    size_t previous = 0;
+    for (auto &call : calls)
+    {
+        if (call.reuse && previous + MAX_ALIGNMENT + call.length <= MAX_SIZE + MAX_ALIGNMENT)
+        {
+            call.input = data + previous + call.alignment;
+            continue;
+        }
+        /* reused call that doesn't fit after the previous one reads fresh region like the others */
+        call.reuse = false;
+        if (cursor + MAX_ALIGNMENT + call.length > MAX_SIZE + MAX_ALIGNMENT)
+            cursor = 0;
+        call.input = data + cursor + call.alignment;
+        previous = cursor;
+        cursor += (call.length + call.alignment + MAX_ALIGNMENT - 1) / MAX_ALIGNMENT * MAX_ALIGNMENT;
+    }
+}
+
+/* Flushes inputs of calls that don't reuse previous buffer, so that they start cold in every pass. */
+static void flush_trace(const std::vector<trace_call> &calls)
+{
+    for (auto &call : calls)
+    {
+        if (!call.reuse && call.length)
+            flush(call.input, call.length);
+    }
+}
+
+/* Replays the whole trace in every trial, repeated like warm measurements if the trace is short. Only the calls are timed. */
+static void replay(const kernel *k, const std::vector<trace_call> &calls)
+{
+    uint64_t bytes = 0;
+    for (auto &call : calls)
+        bytes += call.length;
+    uint32_t crc = 0;
+    for (auto &call : calls)
+        crc ^= k->function(0, call.input, call.length);
+    flush_trace(calls);
+    uint64_t start = ticks();
+    for (auto &call : calls)
+        crc ^= k->function(0, call.input, call.length);
+    double once = (ticks() - start) / ticks_per_ns;
+    uint64_t repeats = std::max<uint64_t>(1, (uint64_t)(TRIAL_NS / std::max(once, 1.0)));
+    std::vector<double> samples;
+    for (int trial = 0; trial < settings.trials; ++trial)
+    {
+        double elapsed = 0;
+        for (uint64_t i = 0; i < repeats; ++i)
+        {
+            flush_trace(calls);
+            start = ticks();
+            for (auto &call : calls)
+                crc ^= k->function(0, call.input, call.length);
+            elapsed += std::max(0.0, (ticks() - start) - timer_overhead);
+        }
+        samples.push_back(elapsed / repeats / ticks_per_ns);
+    }
+    sink ^= crc;
+    stats result = summarize(samples);
+    fprintf(output, "%s\n    { \"kernel\": \"%s\", \"calls\": %zu, \"bytes\": %llu, \"median_ns\": %.0f, \"p99_ns\": %.0f, "
+        "\"calls_per_second\": %.0f, \"median_gbps\": %.3f }",
+        first_result ? "" : ",", k->name, calls.size(), (unsigned long long)bytes, result.median, result.p99,
+        calls.size() * 1e9 / std::max(result.median, 0.001), bytes / std::max(result.median, 0.001));
+    first_result = false;
+}
+
+static uint8_t *allocate(size_t size)
+{
+#if defined(_MSC_VER)
+    return (uint8_t *)_aligned_malloc(size, 4096);
+#else
+    void *memory = NULL;
+    return posix_memalign(&memory, 4096, size) == 0 ? (uint8_t *)memory : NULL;
+#endif
+}
+
+static void release(uint8_t *memory)
+{
+#if defined(_MSC_VER)
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+/* Processors the benchmark may run on, in the order threads are pinned to them. */
+static std::vector<int> allowed_cpus()
+{
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+    }
+#endif
+    if (cpus.empty())
+    {
+        for (int cpu = 0; cpu < std::max(1, (int)std::thread::hardware_concurrency()); ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+static void pin_thread(int cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(_WIN32)
+    if (cpu < 64)
+        SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu);
+#endif
+}
+
+/* Size of data or unified cache at the given level or the fallback if the OS doesn't tell. */
+static size_t cache_size(int level, size_t fallback)
+{
+    long size = 0;
+#if defined(_SC_LEVEL1_DCACHE_SIZE)
+    size = sysconf(level == 1 ? _SC_LEVEL1_DCACHE_SIZE : level == 2 ? _SC_LEVEL2_CACHE_SIZE : _SC_LEVEL3_CACHE_SIZE);
+#endif
+    return size > 0 ? (size_t)size : fallback;
+}
+
+/* One point of the scaling benchmark. Threads start together and stop together. */
+struct scaling_run
+{
+    kernel_function function;
+    size_t size;
+    const uint8_t *shared;
+    int threads;
+    std::atomic<int> ready;
+    std::atomic<bool> go;
+    std::atomic<bool> stop;
+    std::vector<double> gbps;
+};
+
+/* Private buffers are allocated and filled by the pinned thread, so that they are local to its NUMA node.
+   Threads on a shared buffer start at different offsets, so that they don't share cache misses. */
+static void scaling_worker(scaling_run *run, int index, int cpu)
+{
+    pin_thread(cpu);
+    uint8_t *own = NULL;
+    const uint8_t *data = run->shared;
+    size_t offset = 0;
+    if (data)
+        offset = run->size / run->threads * index / 64 * 64;
+    else
+    {
+        own = allocate(run->size);
+        if (!own)
+        {
+            fprintf(stderr, "crc32c-bench: out of memory\n");
+            exit(2);
+        }
+        for (size_t i = 0; i < run->size; ++i)
+            own[i] = (uint8_t)(i * 7 + index);
+        data = own;
+    }
+    ++run->ready;
+    while (!run->go)
+        std::this_thread::yield();
+    uint64_t bytes = 0;
+    uint32_t crc = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (!run->stop.load(std::memory_order_relaxed))
+    {
+        size_t length = std::min<size_t>(SCALING_CHUNK, run->size - offset);
+        crc ^= run->function(0, data + offset, length);
+        bytes += length;
+        offset += length;
+        if (offset >= run->size)
+            offset = 0;
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    run->gbps[index] = bytes / elapsed.count();
+    sink ^= crc;
+    release(own);
+}
+
+/* Aggregate GB/s of the given number of threads, each walking a buffer of the given size. */
+static double scale(kernel_function function, int threads, size_t size, bool shared, const std::vector<int> &cpus)
+{
+    scaling_run run;
+    run.function = function;
+    run.size = size;
+    run.shared = NULL;
+    run.threads = threads;
+    run.ready = 0;
+    run.go = false;
+    run.stop = false;
+    run.gbps.resize(threads);
+    uint8_t *buffer = NULL;
+    if (shared)
+    {
+        buffer = allocate(size);
+        if (!buffer)
+        {
+            fprintf(stderr, "crc32c-bench: out of memory\n");
+            exit(2);
+        }
+        for (size_t i = 0; i < size; ++i)
+            buffer[i] = (uint8_t)(i * 7);
+        run.shared = buffer;
+    }
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i)
+        workers.emplace_back(scaling_worker, &run, i, cpus[i % cpus.size()]);
+    while (run.ready < threads)
+        std::this_thread::yield();
+    run.go = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(SCALING_MS));
+    run.stop = true;
+    for (auto &worker : workers)
+        worker.join();
+    release(buffer);
+    double total = 0;
+    for (double gbps : run.gbps)
+        total += gbps;
+    return total;
+}
+
+/*
+    Runs 1 to N pinned threads over private and shared buffers that fit in L1, L2, LLC, or only in DRAM.
+    L1 and L2 sets are per core, so private buffers have the same size for every thread count.
+    LLC and DRAM sets are split among threads of private runs, so that the total stays the same.
+    Efficiency is aggregate throughput relative to the single-thread throughput times thread count.
+*/
+static void scaling(const kernel *k, const std::vector<int> &cpus, const size_t *sets)
+{
+    static const char *names[] = { "L1", "L2", "LLC", "DRAM" };
+    for (int shared = 0; shared < 2; ++shared)
+    {
+        for (int level = 0; level < 4; ++level)
+        {
+            double single = 0;
+            for (int threads = 1; threads <= settings.threads; ++threads)
+            {
+                size_t size = sets[level];
+                if (!shared && level >= 2)
+                    size = std::max<size_t>(SCALING_CHUNK, size / threads / 64 * 64);
+                double gbps = scale(k->function, threads, size, shared != 0, cpus);
+                if (threads == 1)
+                    single = gbps;
+                fprintf(output, "%s\n    { \"kernel\": \"%s\", \"buffer\": \"%s\", \"working_set\": \"%s\", \"threads\": %d, "
+                    "\"bytes_per_thread\": %zu, \"gbps\": %.3f, \"per_thread_gbps\": %.3f, \"efficiency\": %.3f }",
+                    first_result ? "" : ",", k->name, shared ? "shared" : "private", names[level], threads,
+                    size, gbps, gbps / threads, gbps / (threads * std::max(single, 1e-9)));
+                first_result = false;
+            }
+        }
+    }
+}
+
+/* Writes JSON string literal. */
+static void print_string(const char *text)
+{
+    fputc('"', output);
+    for (; *text; ++text)
+    {
+        if (*text == '"' || *text == '\\')
+            fprintf(output, "\\%c", *text);
+        else if ((unsigned char)*text < 0x20)
+            fprintf(output, "\\u%04x", *text);
+        else
+            fputc(*text, output);
+    }
+    fputc('"', output);
+}
+
+static void cpu_brand(char *brand)
+{
+    int info[12];
+#if defined(_MSC_VER)
+    __cpuid(info, 0x80000002);
+    __cpuid(info + 4, 0x80000003);
+    __cpuid(info + 8, 0x80000004);
+#else
+    __cpuid(0x80000002, info[0], info[1], info[2], info[3]);
+    __cpuid(0x80000003, info[4], info[5], info[6], info[7]);
+    __cpuid(0x80000004, info[8], info[9], info[10], info[11]);
+#endif
+    memcpy(brand, info, sizeof(info));
+    brand[sizeof(info)] = 0;
+}
+
+static void usage(FILE *stream)
+{
+    fprintf(stream,
+        "Usage: crc32c-bench [OPTION]...\n"
+        "Measure CRC-32C kernels over input sizes, alignments, and cache states and print JSON.\n"
+        "\n"
+        "  -k, --kernel K    benchmark kernel K, can be repeated (default: all available)\n"
+        "                    sw, sw4, sw8, sw16, braided, hw, hybrid, clmul, vpclmul,\n"
+        "                    auto, calibrated\n"
+        "      --min-size N  smallest input of the size sweep (default: 1)\n"
+        "      --max-size N  largest input of the size sweep, at most 64MB (default: 64MB)\n"
+        "  -t, --trials N    trials per measurement (default: 31)\n"
+        "      --cache C     'warm', 'cold', or 'both' (default)\n"
+        "      --no-align    skip alignment sweep\n"
+        "      --trace F     replay calls from trace file F instead of the sweeps, one call per line:\n"
+        "                    length, alignment 0-63, and 1 if the call reuses previous buffer, else 0\n"
+        "      --scaling     instead of the sweeps, run 1 to N pinned threads over private and shared buffers\n"
+        "                    in L1, L2, LLC, and DRAM (default kernel: hw)\n"
+        "      --threads N   maximum thread count of the scaling benchmark (default: number of processors)\n"
+        "  -o, --output F    write JSON to F instead of standard output\n"
+        "  -h, --help        display this help and exit\n");
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if ((arg == "-k" || arg == "--kernel") && i + 1 < argc)
+        {
+            std::string name = argv[++i];
+            const kernel *found = NULL;
+            for (auto &k : kernels)
+                if (name == k.name)
+                    found = &k;
+            if (!found)
+            {
+                fprintf(stderr, "crc32c-bench: unknown kernel %s\n", name.c_str());
+                return 2;
+            }
+            settings.kernels.push_back(found);
+        }
+        else if (arg == "--min-size" && i + 1 < argc)
+            settings.min_size = (size_t)std::max(1LL, atoll(argv[++i]));
+        else if (arg == "--max-size" && i + 1 < argc)
+            settings.max_size = (size_t)std::min((long long)MAX_SIZE, std::max(1LL, atoll(argv[++i])));
+        else if ((arg == "-t" || arg == "--trials") && i + 1 < argc)
+            settings.trials = std::max(1, atoi(argv[++i]));
+        else if (arg == "--cache" && i + 1 < argc)
+        {
+            std::string cache = argv[++i];
+            if (cache != "warm" && cache != "cold" && cache != "both")
+            {
+                usage(stderr);
+                return 2;
+            }
+            settings.warm = cache != "cold";
+            settings.cold = cache != "warm";
+        }
+        else if (arg == "--no-align")
+            settings.alignments = false;
+        else if (arg == "--trace" && i + 1 < argc)
+            settings.trace = argv[++i];
+        else if (arg == "--scaling")
+            settings.scaling = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            settings.threads = std::max(1, atoi(argv[++i]));
+        else if ((arg == "-o" || arg == "--output") && i + 1 < argc)
+            settings.output = argv[++i];
+        else if (arg == "-h" || arg == "--help")
+        {
+            usage(stdout);
+            return 0;
+        }
+        else
+        {
+            usage(stderr);
+            return 2;
+        }
+    }
+    if (settings.kernels.empty())
+    {
+        for (auto &k : kernels)
+        {
+            /* scaling is slow, so it measures only the crc instruction unless told otherwise */
+            if (!settings.scaling || strcmp(k.name, crc32c_hw_available() ? "hw" : "auto") == 0)
+                settings.kernels.push_back(&k);
+        }
+    }
+    for (auto k : settings.kernels)
+    {
+        if (!k->available())
+        {
+            fprintf(stderr, "crc32c-bench: kernel %s is not supported by this CPU\n", k->name);
+            return 2;
+        }
+    }
+
+    std::vector<trace_call> calls;
+    if (settings.trace && !load_trace(settings.trace, calls))
+        return 2;
+
+    output = settings.output ? fopen(settings.output, "w") : stdout;
+    if (!output)
+    {
+        fprintf(stderr, "crc32c-bench: %s: %s\n", settings.output, strerror(errno));
+        return 2;
+    }
+    size_t capacity = MAX_SIZE + MAX_ALIGNMENT;
+    uint8_t *data = allocate(capacity);
+    if (!data)
+    {
+        fprintf(stderr, "crc32c-bench: out of memory\n");
+        return 2;
+    }
+    std::mt19937 random(1);
+    for (size_t i = 0; i < capacity; ++i)
+        data[i] = (uint8_t)random();
+    /* run one-time initialization and kernel selection before anything is timed */
+    crc32c_init();
+    calibrate_timer();
+
+    char brand[49];
+    cpu_brand(brand);
+    fprintf(output, "{\n  \"cpu\": ");
+    print_string(brand);
+    fprintf(output, ",\n  \"tsc_ghz\": %.3f,\n  \"timer_overhead_ns\": %.2f,\n  \"trials\": %d,\n",
+        ticks_per_ns, timer_overhead / ticks_per_ns, settings.trials);
+    if (settings.trace)
+    {
+        fprintf(output, "  \"trace\": ");
+        print_string(settings.trace);
+        fprintf(output, ",\n");
+        place_trace(calls, data);
+    }
+    std::vector<int> cpus = allowed_cpus();
+    size_t sets[4];
+    if (settings.scaling)
+    {
+        if (!settings.threads)
+            settings.threads = (int)cpus.size();
+        /* half of the cache leaves room for code, stack, and the other buffers */
+        sets[0] = cache_size(1, 32 * 1024) / 2;
+        sets[1] = cache_size(2, 1024 * 1024) / 2;
+        sets[2] = cache_size(3, 8 * 1024 * 1024) / 2;
+        sets[3] = std::min<size_t>(DRAM_MAX, std::max<size_t>(DRAM_MIN, 4 * cache_size(3, 8 * 1024 * 1024)));
+        fprintf(output, "  \"processors\": %d,\n  \"working_sets\": { \"L1\": %zu, \"L2\": %zu, \"LLC\": %zu, \"DRAM\": %zu },\n",
+            (int)cpus.size(), sets[0], sets[1], sets[2], sets[3]);
+    }
+    fprintf(output, "  \"results\": [");
+    for (auto k : settings.kernels)
+    {
+        fprintf(stderr, "%s\n", k->name);
+        if (settings.scaling)
+            scaling(k, cpus, sets);
+        else if (settings.trace)
+            replay(k, calls);
+        else
+            sweep(k, data);
+    }
+    fprintf(output, "\n  ]\n}\n");
+    if (output != stdout)
+        fclose(output);
+    release(data);
+    return 0;
+}
@@ -81,7 +81,7 @@ static uint32_t mod_poly(buffer input, int length, uint32_t poly)
 static uint64_t div_poly(buffer input, int length, uint32_t poly)
 {
     uint32_t r = ((uint32_t)input[0] << 24) | ((uint32_t)input[1] << 16) | ((uint32_t)input[2] << 8) | (uint32_t)input[3];
-    uint32_t d = 0;
+    uint64_t d = 0;
     while (length > 4)
     {
         for (int b = 7; b >= 0; --b)
@@ -211,6 +211,22 @@ static void make_shift_table(uint32_t shift_table[][256], size_t len, uint32_t p
     }
 }
 
+/* Build operators x^(8*2^k) mod P(x) for k = 0..levels-1.  Each operator is the image
+   of x^0 under the matrix that appends 2^k zero bytes. */
+static void make_zeros_ops(uint32_t *ops, int levels, uint32_t poly)
+{
+    uint32_t op[32];
+    uint32_t square[32];
+    make_shift_op(op, 1, poly);
+    for (int k = 0; k < levels; ++k)
+    {
+        ops[k] = op[31];
+        gf2_matrix_square(square, op);
+        for (int n = 0; n < 32; ++n)
+            op[n] = square[n];
+    }
+}
+
 static void write_table(std::ostream& out, uint32_t table[][256], int levels, const char *name)
 {
     out << "static uint32_t " << name << "[" << levels << "][256] =" << std::endl;
@@ -251,8 +267,27 @@ static void write_shift_table(std::ostream& out, uint32_t shift_table[][256], co
     out << std::endl << "};" << std::endl;
 }
 
+static void write_zeros_ops(std::ostream& out, uint32_t *ops, int levels, const char *name)
+{
+    out << "static uint32_t " << name << "[" << std::dec << levels << "] = {" << std::endl;
+    for (int k = 0; k < levels; ++k)
+    {
+        if (k % 8 == 0)
+            out << "    ";
+        out << "0x" << std::hex << std::setw(8) << std::setfill('0') << ops[k];
+        if (k + 1 < levels)
+            out << (k % 8 == 7 ? "," : ", ");
+        if (k % 8 == 7 || k + 1 == levels)
+            out << std::endl;
+    }
+    out << "};" << std::endl;
+}
+
 static uint32_t table[16][256];
 
+/* Operators that append 2^k zeros to a crc. */
+static uint32_t zeros_ops[64];
+
 /* Tables for hardware crc that shift a crc by LONG_SHIFT and SHORT_SHIFT zeros. */
 static uint32_t long_shifts[4][256];
 static uint32_t short_shifts[4][256];
@@ -281,17 +316,28 @@ static __m128i fold_one(__m128i input)
     return _mm_castps_si128(_mm_xor_ps(_mm_castsi128_ps(shifted), _mm_castsi128_ps(lower)));
 }
 
-static void check_clmul_constants()
+/* Constant u' for Barrett reduction is bit-reflected 33-bit quotient x^64 div P(x). */
+static uint64_t compute_reversed_barrett_constant(uint32_t poly)
 {
-    std::cout << "P(x)' = " << std::hex << reverse_full(IEEEPOLY) << std::endl;
-    std::cout << "k1' = " << std::hex << compute_reversed_clmul_constant(4 * 128 + 32, IEEEPOLY) << std::endl;
-    std::cout << "k2' = " << std::hex << compute_reversed_clmul_constant(4 * 128 - 32, IEEEPOLY) << std::endl;
-    std::cout << "k3' = " << std::hex << compute_reversed_clmul_constant(128 + 32, IEEEPOLY) << std::endl;
-    std::cout << "k4' = " << std::hex << compute_reversed_clmul_constant(128 - 32, IEEEPOLY) << std::endl;
-    std::cout << "k5' = " << std::hex << compute_reversed_clmul_constant(64, IEEEPOLY) << std::endl;
-    std::cout << "k6' = " << std::hex << compute_reversed_clmul_constant(32, IEEEPOLY) << std::endl;
     static uint8_t a[100] = { 1 };
-    std::cout << "u' = " << std::hex << ((uint64_t)reverse_bitwise((uint32_t)div_poly(a, 9, IEEEPOLY)) << 1) << std::endl;
+    uint64_t quotient = div_poly(a, 9, poly);
+    return ((uint64_t)reverse_bitwise((uint32_t)quotient) << 1) | (quotient >> 32);
+}
+
+static void check_clmul_constants(uint32_t poly)
+{
+    std::cout << "P(x)' = " << std::hex << reverse_full(poly) << std::endl;
+    std::cout << "k1' = " << std::hex << compute_reversed_clmul_constant(4 * 128 + 32, poly) << std::endl;
+    std::cout << "k2' = " << std::hex << compute_reversed_clmul_constant(4 * 128 - 32, poly) << std::endl;
+    std::cout << "k3' = " << std::hex << compute_reversed_clmul_constant(128 + 32, poly) << std::endl;
+    std::cout << "k4' = " << std::hex << compute_reversed_clmul_constant(128 - 32, poly) << std::endl;
+    std::cout << "k5' = " << std::hex << compute_reversed_clmul_constant(64, poly) << std::endl;
+    std::cout << "k6' = " << std::hex << compute_reversed_clmul_constant(32, poly) << std::endl;
+    std::cout << "u' = " << std::hex << compute_reversed_barrett_constant(poly) << std::endl;
+}
+
+static void check_fold_one()
+{
     __m128i magic = _mm_set_epi32(0, 0, 0, 0x9db42487);
     for (int i = 0; i < 65; ++i)
     {
@@ -300,15 +346,36 @@ static void check_clmul_constants()
     }
 }
 
+static void write_clmul_constant(std::ostream& out, const char *name, uint64_t value)
+{
+    out << "#define " << name << " 0x" << std::hex << std::setw(9) << std::setfill('0') << value << std::dec << std::endl;
+}
+
+static void write_clmul_constants(std::ostream& out, uint32_t poly)
+{
+    write_clmul_constant(out, "CLMUL_K1", compute_reversed_clmul_constant(4 * 128 + 32, poly));
+    write_clmul_constant(out, "CLMUL_K2", compute_reversed_clmul_constant(4 * 128 - 32, poly));
+    write_clmul_constant(out, "CLMUL_K3", compute_reversed_clmul_constant(128 + 32, poly));
+    write_clmul_constant(out, "CLMUL_K4", compute_reversed_clmul_constant(128 - 32, poly));
+    write_clmul_constant(out, "CLMUL_K5", compute_reversed_clmul_constant(64, poly));
+    write_clmul_constant(out, "CLMUL_POLY", reverse_full(poly));
+    write_clmul_constant(out, "CLMUL_MU", compute_reversed_barrett_constant(poly));
+    write_clmul_constant(out, "VPCLMUL_K1", compute_reversed_clmul_constant(16 * 128 + 32, poly));
+    write_clmul_constant(out, "VPCLMUL_K2", compute_reversed_clmul_constant(16 * 128 - 32, poly));
+}
+
 int main(int argc, char* argv[])
 {
     try
     {
-        check_clmul_constants();
+        check_clmul_constants(IEEEPOLY);
+        check_fold_one();
+        check_clmul_constants(POLY);
         uint32_t reversed_poly = reverse_bitwise(POLY);
         initialize_table(table, 16, reversed_poly);
         make_shift_table(long_shifts, LONG_SHIFT, reversed_poly);
         make_shift_table(short_shifts, SHORT_SHIFT, reversed_poly);
+        make_zeros_ops(zeros_ops, 64, reversed_poly);
         std::ofstream out;
         out.exceptions(std::ios::badbit | std::ios::failbit);
         out.open("generated-constants.cpp", std::ios_base::trunc);
@@ -316,11 +383,15 @@ int main(int argc, char* argv[])
         out << "#define LONG_SHIFT " << LONG_SHIFT << std::endl;
         out << "#define SHORT_SHIFT " << SHORT_SHIFT << std::endl;
         out << std::endl;
+        write_clmul_constants(out, POLY);
+        out << std::endl;
         write_table(out, table, 16, "table");
         out << std::endl;
         write_shift_table(out, long_shifts, "long_shifts");
         out << std::endl;
         write_shift_table(out, short_shifts, "short_shifts");
+        out << std::endl;
+        write_zeros_ops(out, zeros_ops, 64, "zeros_ops");
     }
     catch (const std::exception &e)
     {
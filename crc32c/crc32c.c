@@ -23,6 +23,11 @@
 #define _CRT_SECURE_NO_WARNINGS
 #endif
 
+/* clock_gettime, madvise, and posix_fadvise are hidden by strict ISO C modes (e.g. -std=c11) unless asked for. */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
 #include "crc32c.h"
 
 #define NOMINMAX
@@ -34,10 +39,61 @@
 #include <intrin.h>
 #endif
 
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #define POLY 0x82f63b78
 #define LONG_SHIFT 8192
 #define SHORT_SHIFT 256
 
+/* crc32c_append_parallel doesn't split input into parts shorter than this,
+   because thread startup would cost more than it saves. */
+#define PARALLEL_MIN (4 * 1024 * 1024)
+
+/* crc32c_file maps this much of the file at a time, which bounds its memory footprint.
+   It must be a multiple of page size and of allocation granularity on Windows. */
+#define FILE_WINDOW (64 * 1024 * 1024)
+
+/* Constants for PCLMULQDQ folding and Barrett reduction as generated by constants.cpp.
+   All of them are bit-reflected and shifted left by one bit, so that carry-less
+   multiplication of reflected operands produces correctly aligned results. */
+#define CLMUL_K1 0x0740eef02            /* x^(4*128+32) mod P(x) */
+#define CLMUL_K2 0x09e4addf8            /* x^(4*128-32) mod P(x) */
+#define CLMUL_K3 0x0f20c0dfe            /* x^(128+32) mod P(x) */
+#define CLMUL_K4 0x14cd00bd6            /* x^(128-32) mod P(x) */
+#define CLMUL_K5 0x0dd45aab8            /* x^64 mod P(x) */
+#define CLMUL_POLY 0x105ec76f1          /* P(x) */
+#define CLMUL_MU 0x0dea713f1            /* x^64 div P(x) */
+#define VPCLMUL_K1 0x0dcb17aa4          /* x^(16*128+32) mod P(x) */
+#define VPCLMUL_K2 0x0b9e02b86          /* x^(16*128-32) mod P(x) */
+
+/* Inputs shorter than this are not worth the setup and reduction overhead of folding. */
+#define CLMUL_MIN 256
+
+/* Inputs shorter than this don't use 512-bit registers, because the short burst of
+   wide instructions would not pay for the frequency drop on some CPUs. */
+#define VPCLMUL_MIN 4096
+
+#ifdef CRC32C_GCC
+#define CRC32C_TARGET(isa) __attribute__((target(isa)))
+#define CRC32C_FORCEINLINE inline __attribute__((always_inline))
+#else
+#define CRC32C_TARGET(isa)
+#define CRC32C_FORCEINLINE __forceinline
+#endif
+
 typedef const uint8_t *buffer;
 
 static union {
@@ -832,75 +888,89 @@ static union {
     }
 };
 
+/* Operators x^(8*2^k) mod P(x) that append 2^k zero bytes to a crc when multiplied with it. */
+static uint32_t zeros_ops[64] = {
+    0x00800000, 0x00008000, 0x82f63b78, 0x6ea2d55c, 0x18b8ea18, 0x510ac59a, 0xb82be955, 0xb8fdb1e7,
+    0x88e56f72, 0x74c360a4, 0xe4172b16, 0x0d65762a, 0x35d73a62, 0x28461564, 0xbf455269, 0xe2ea32dc,
+    0xfe7740e6, 0xf946610b, 0x3c204f8f, 0x538586e3, 0x59726915, 0x734d5309, 0xbc1ac763, 0x7d0722cc,
+    0xd289cabe, 0xe94ca9bc, 0x05b74f3f, 0xa51e1f42, 0x40000000, 0x20000000, 0x08000000, 0x00800000,
+    0x00008000, 0x82f63b78, 0x6ea2d55c, 0x18b8ea18, 0x510ac59a, 0xb82be955, 0xb8fdb1e7, 0x88e56f72,
+    0x74c360a4, 0xe4172b16, 0x0d65762a, 0x35d73a62, 0x28461564, 0xbf455269, 0xe2ea32dc, 0xfe7740e6,
+    0xf946610b, 0x3c204f8f, 0x538586e3, 0x59726915, 0x734d5309, 0xbc1ac763, 0x7d0722cc, 0xd289cabe,
+    0xe94ca9bc, 0x05b74f3f, 0xa51e1f42, 0x40000000, 0x20000000, 0x08000000, 0x00800000, 0x00008000
+};
+
+/* Fold one 32-bit word through four consecutive tables starting at base. */
+static inline uint32_t slice4(uint32_t word, int base)
+{
+    return table.dword_table[base + 3][word & 0xff]
+        ^ table.dword_table[base + 2][(word >> 8) & 0xff]
+        ^ table.dword_table[base + 1][(word >> 16) & 0xff]
+        ^ table.dword_table[base][word >> 24];
+}
+
+#ifdef CRC32C_X64
+/* Fold one 64-bit word through eight consecutive tables starting at base. */
+static inline uint32_t slice8(uint64_t word, int base)
+{
+    return table.dword_table[base + 7][word & 0xff]
+        ^ table.dword_table[base + 6][(word >> 8) & 0xff]
+        ^ table.dword_table[base + 5][(word >> 16) & 0xff]
+        ^ table.dword_table[base + 4][(word >> 24) & 0xff]
+        ^ table.dword_table[base + 3][(word >> 32) & 0xff]
+        ^ table.dword_table[base + 2][(word >> 40) & 0xff]
+        ^ table.dword_table[base + 1][(word >> 48) & 0xff]
+        ^ table.dword_table[base][word >> 56];
+}
+#endif
+
 /* Table-driven software version as a fall-back.  This is about 15 times slower
    than using the hardware instructions.  This assumes little-endian integers,
-   as is the case on Intel processors that the assembler code here is for. */
-CRC32C_API uint32_t crc32c_append_sw(uint32_t crci, buffer input, size_t length)
+   as is the case on Intel processors that the assembler code here is for.
+   Slicing by more bytes is faster, but it reads from slices KB of tables, which
+   evicts more of the caller's data from L1 cache.  Slices must be a constant
+   4, 8, 12, or 16, so that the branches below are resolved at compile time. */
+static inline uint32_t append_sliced(uint32_t crci, buffer input, size_t length, int slices)
 {
     buffer next = input;
-#ifdef _M_X64
+#ifdef CRC32C_X64
     uint64_t crc;
 #else
     uint32_t crc;
 #endif
 
     crc = crci ^ 0xffffffff;
-#ifdef _M_X64
     while (length && ((uintptr_t)next & 7) != 0)
     {
         crc = table.dword_table[0][(crc ^ *next++) & 0xff] ^ (crc >> 8);
         --length;
     }
-    while (length >= 16)
+    while (length >= (size_t)slices)
     {
-        crc ^= *(uint64_t *)next;
-        uint64_t high = *(uint64_t *)(next + 8);
-        crc = table.dword_table[15][crc & 0xff]
-            ^ table.dword_table[14][(crc >> 8) & 0xff]
-            ^ table.dword_table[13][(crc >> 16) & 0xff]
-            ^ table.dword_table[12][(crc >> 24) & 0xff]
-            ^ table.dword_table[11][(crc >> 32) & 0xff]
-            ^ table.dword_table[10][(crc >> 40) & 0xff]
-            ^ table.dword_table[9][(crc >> 48) & 0xff]
-            ^ table.dword_table[8][crc >> 56]
-            ^ table.dword_table[7][high & 0xff]
-            ^ table.dword_table[6][(high >> 8) & 0xff]
-            ^ table.dword_table[5][(high >> 16) & 0xff]
-            ^ table.dword_table[4][(high >> 24) & 0xff]
-            ^ table.dword_table[3][(high >> 32) & 0xff]
-            ^ table.dword_table[2][(high >> 40) & 0xff]
-            ^ table.dword_table[1][(high >> 48) & 0xff]
-            ^ table.dword_table[0][high >> 56];
-        next += 16;
-        length -= 16;
-    }
+#ifdef CRC32C_X64
+        if (slices == 4)
+            crc = slice4((uint32_t)crc ^ *(const uint32_t *)next, 0);
+        else if (slices == 8)
+            crc = slice8(crc ^ *(const uint64_t *)next, 0);
+        else if (slices == 12)
+            crc = slice8(crc ^ *(const uint64_t *)next, 4)
+                ^ slice4(*(const uint32_t *)(next + 8), 0);
+        else
+            crc = slice8(crc ^ *(const uint64_t *)next, 8)
+                ^ slice8(*(const uint64_t *)(next + 8), 0);
 #else
-    while (length && ((uintptr_t)next & 3) != 0)
-    {
-        crc = table.dword_table[0][(crc ^ *next++) & 0xff] ^ (crc >> 8);
-        --length;
-    }
-    while (length >= 12)
-    {
-        crc ^= *(uint32_t *)next;
-        uint32_t high = *(uint32_t *)(next + 4);
-        uint32_t high2 = *(uint32_t *)(next + 8);
-        crc = table.dword_table[11][crc & 0xff]
-            ^ table.dword_table[10][(crc >> 8) & 0xff]
-            ^ table.dword_table[9][(crc >> 16) & 0xff]
-            ^ table.dword_table[8][crc >> 24]
-            ^ table.dword_table[7][high & 0xff]
-            ^ table.dword_table[6][(high >> 8) & 0xff]
-            ^ table.dword_table[5][(high >> 16) & 0xff]
-            ^ table.dword_table[4][high >> 24]
-            ^ table.dword_table[3][high2 & 0xff]
-            ^ table.dword_table[2][(high2 >> 8) & 0xff]
-            ^ table.dword_table[1][(high2 >> 16) & 0xff]
-            ^ table.dword_table[0][high2 >> 24];
-        next += 12;
-        length -= 12;
-    }
+        uint32_t folded = slice4(crc ^ *(const uint32_t *)next, slices - 4);
+        if (slices >= 8)
+            folded ^= slice4(*(const uint32_t *)(next + 4), slices - 8);
+        if (slices >= 12)
+            folded ^= slice4(*(const uint32_t *)(next + 8), slices - 12);
+        if (slices >= 16)
+            folded ^= slice4(*(const uint32_t *)(next + 12), 0);
+        crc = folded;
 #endif
+        next += slices;
+        length -= slices;
+    }
     while (length)
     {
         crc = table.dword_table[0][(crc ^ *next++) & 0xff] ^ (crc >> 8);
@@ -909,6 +979,26 @@ CRC32C_API uint32_t crc32c_append_sw(uint32_t crci, buffer input, size_t length)
     return (uint32_t)crc ^ 0xffffffff;
 }
 
+CRC32C_API uint32_t crc32c_append_sw(uint32_t crc, buffer input, size_t length)
+{
+    return append_sliced(crc, input, length, CRC32C_SW_SLICES);
+}
+
+CRC32C_API uint32_t crc32c_append_sw4(uint32_t crc, buffer input, size_t length)
+{
+    return append_sliced(crc, input, length, 4);
+}
+
+CRC32C_API uint32_t crc32c_append_sw8(uint32_t crc, buffer input, size_t length)
+{
+    return append_sliced(crc, input, length, 8);
+}
+
+CRC32C_API uint32_t crc32c_append_sw16(uint32_t crc, buffer input, size_t length)
+{
+    return append_sliced(crc, input, length, 16);
+}
+
 /* Apply the zeros operator table to crc. */
 static inline uint32_t shift_crc(uint32_t shift_table[][256], uint32_t crc)
 {
@@ -918,12 +1008,128 @@ static inline uint32_t shift_crc(uint32_t shift_table[][256], uint32_t crc)
         ^ shift_table[3][crc >> 24];
 }
 
+/* Advance crc over 16 bytes with slice-by-16 table lookups. */
+static inline uint32_t slice_step16(uint32_t crc, buffer next)
+{
+#ifdef CRC32C_X64
+    return slice8(crc ^ *(const uint64_t *)next, 8) ^ slice8(*(const uint64_t *)(next + 8), 0);
+#else
+    return slice4(crc ^ *(const uint32_t *)next, 12)
+        ^ slice4(*(const uint32_t *)(next + 4), 8)
+        ^ slice4(*(const uint32_t *)(next + 8), 4)
+        ^ slice4(*(const uint32_t *)(next + 12), 0);
+#endif
+}
+
+/* Software version that runs three independent slice-by-16 streams over adjacent blocks and
+   merges them with the zeros operator tables, just like crc32c_append_hw does with crc
+   instructions.  A single stream waits for the previous lookups before it can compute
+   the next table index, while three streams keep more loads in flight. */
+CRC32C_API uint32_t crc32c_append_braided(uint32_t crc, buffer buf, size_t len)
+{
+    buffer next = buf;
+    buffer end;
+    uint32_t crc0, crc1, crc2;
+
+    /* short inputs would gain nothing from the three streams */
+    if (len < 3 * SHORT_SHIFT)
+        return crc32c_append_sw(crc, buf, len);
+
+    /* pre-process the crc and bring the data pointer to an eight-byte boundary */
+    crc0 = crc ^ 0xffffffff;
+    while ((uintptr_t)next & 7)
+    {
+        crc0 = table.dword_table[0][(crc0 ^ *next++) & 0xff] ^ (crc0 >> 8);
+        --len;
+    }
+
+    /* three streams on LONG_SHIFT blocks, which are multiples of 16 bytes */
+    while (len >= 3 * LONG_SHIFT)
+    {
+        crc1 = 0;
+        crc2 = 0;
+        end = next + LONG_SHIFT;
+        do
+        {
+            crc0 = slice_step16(crc0, next);
+            crc1 = slice_step16(crc1, next + LONG_SHIFT);
+            crc2 = slice_step16(crc2, next + 2 * LONG_SHIFT);
+            next += 16;
+        } while (next < end);
+        crc0 = shift_crc(long_shifts.dword_table, crc0) ^ crc1;
+        crc0 = shift_crc(long_shifts.dword_table, crc0) ^ crc2;
+        next += 2 * LONG_SHIFT;
+        len -= 3 * LONG_SHIFT;
+    }
+
+    /* the same on SHORT_SHIFT blocks for the remaining data less than a LONG_SHIFT*3 block */
+    while (len >= 3 * SHORT_SHIFT)
+    {
+        crc1 = 0;
+        crc2 = 0;
+        end = next + SHORT_SHIFT;
+        do
+        {
+            crc0 = slice_step16(crc0, next);
+            crc1 = slice_step16(crc1, next + SHORT_SHIFT);
+            crc2 = slice_step16(crc2, next + 2 * SHORT_SHIFT);
+            next += 16;
+        } while (next < end);
+        crc0 = shift_crc(short_shifts.dword_table, crc0) ^ crc1;
+        crc0 = shift_crc(short_shifts.dword_table, crc0) ^ crc2;
+        next += 2 * SHORT_SHIFT;
+        len -= 3 * SHORT_SHIFT;
+    }
+
+    /* the remaining data less than a SHORT_SHIFT*3 block */
+    return crc32c_append_sw(crc0 ^ 0xffffffff, next, len);
+}
+
+/* Compute crc of data without aligning it first.  Unaligned loads are cheap and they
+   are not on the critical path, which is the dependency chain of crc instructions, so
+   short inputs are better off without the byte-wise alignment loop.  The last few bytes
+   are processed with at most one 4-byte, 2-byte, and 1-byte step.  The crc is not
+   pre- or post-processed. */
+#ifdef CRC32C_X64
+static inline uint64_t append_unaligned_hw(uint64_t crc, buffer next, size_t len)
+{
+    buffer end = next + (len & ~(size_t)7);
+    while (next < end)
+    {
+        crc = _mm_crc32_u64(crc, *(const uint64_t *)next);
+        next += 8;
+    }
+    if (len & 4)
+    {
+        crc = _mm_crc32_u32((uint32_t)crc, *(const uint32_t *)next);
+        next += 4;
+    }
+#else
+static inline uint32_t append_unaligned_hw(uint32_t crc, buffer next, size_t len)
+{
+    buffer end = next + (len & ~(size_t)3);
+    while (next < end)
+    {
+        crc = _mm_crc32_u32(crc, *(const uint32_t *)next);
+        next += 4;
+    }
+#endif
+    if (len & 2)
+    {
+        crc = _mm_crc32_u16((uint32_t)crc, *(const uint16_t *)next);
+        next += 2;
+    }
+    if (len & 1)
+        crc = _mm_crc32_u8((uint32_t)crc, *next);
+    return crc;
+}
+
 /* Compute CRC-32C using the Intel hardware instruction. */
 CRC32C_API uint32_t crc32c_append_hw(uint32_t crc, buffer buf, size_t len)
 {
     buffer next = buf;
     buffer end;
-#ifdef _M_X64
+#ifdef CRC32C_X64
     uint64_t crc0, crc1, crc2;      /* need to be 64 bits for crc32q */
 #else
     uint32_t crc0, crc1, crc2;
@@ -932,16 +1138,32 @@ CRC32C_API uint32_t crc32c_append_hw(uint32_t crc, buffer buf, size_t len)
     /* pre-process the crc */
     crc0 = crc ^ 0xffffffff;
 
-    /* compute the crc for up to seven leading bytes to bring the data pointer
-       to an eight-byte boundary */
-    while (len && ((uintptr_t)next & 7) != 0)
+    /* inputs too short for the interleaved loops below are not worth aligning */
+    if (len < 3 * SHORT_SHIFT)
+        return (uint32_t)(append_unaligned_hw(crc0, next, len)) ^ 0xffffffff;
+
+    /* compute the crc for up to seven leading bytes in at most three steps to bring
+       the data pointer to an eight-byte boundary */
+    if ((uintptr_t)next & 1)
     {
         crc0 = _mm_crc32_u8((uint32_t)(crc0), *next);
-        ++next;
-        --len;
+        next += 1;
+        len -= 1;
+    }
+    if ((uintptr_t)next & 2)
+    {
+        crc0 = _mm_crc32_u16((uint32_t)(crc0), *(const uint16_t *)next);
+        next += 2;
+        len -= 2;
+    }
+    if ((uintptr_t)next & 4)
+    {
+        crc0 = _mm_crc32_u32((uint32_t)(crc0), *(const uint32_t *)next);
+        next += 4;
+        len -= 4;
     }
 
-#ifdef _M_X64
+#ifdef CRC32C_X64
     /* compute the crc on sets of LONG_SHIFT*3 bytes, executing three independent crc
        instructions, each on LONG_SHIFT bytes -- this is optimized for the Nehalem,
        Westmere, Sandy Bridge, and Ivy Bridge architectures, which have a
@@ -983,15 +1205,6 @@ CRC32C_API uint32_t crc32c_append_hw(uint32_t crc, buffer buf, size_t len)
         next += 2 * SHORT_SHIFT;
         len -= 3 * SHORT_SHIFT;
     }
-
-    /* compute the crc on the remaining eight-byte units less than a SHORT_SHIFT*3
-    block */
-    end = next + (len - (len & 7));
-    while (next < end)
-    {
-        crc0 = _mm_crc32_u64(crc0, *(const uint64_t *)(next));
-        next += 8;
-    }
 #else
     /* compute the crc on sets of LONG_SHIFT*3 bytes, executing three independent crc
     instructions, each on LONG_SHIFT bytes -- this is optimized for the Nehalem,
@@ -1034,28 +1247,340 @@ CRC32C_API uint32_t crc32c_append_hw(uint32_t crc, buffer buf, size_t len)
         next += 2 * SHORT_SHIFT;
         len -= 3 * SHORT_SHIFT;
     }
+#endif
 
-    /* compute the crc on the remaining eight-byte units less than a SHORT_SHIFT*3
-    block */
-    end = next + (len - (len & 7));
-    while (next < end)
+    /* compute the crc on the remaining data less than a SHORT_SHIFT*3 block and
+       return a post-processed crc */
+    return (uint32_t)(append_unaligned_hw(crc0, next, len)) ^ 0xffffffff;
+}
+
+/* Fold 128-bit accumulator over the distance encoded in the pair of constants k and add data. */
+CRC32C_TARGET("sse4.2,pclmul")
+static inline __m128i clmul_fold(__m128i acc, __m128i k, __m128i data)
+{
+    __m128i lower = _mm_clmulepi64_si128(acc, k, 0x00);
+    __m128i upper = _mm_clmulepi64_si128(acc, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(lower, upper), data);
+}
+
+/* Reduce 128-bit accumulator to 32-bit crc using Barrett reduction. */
+CRC32C_TARGET("sse4.2,pclmul")
+static inline uint32_t clmul_reduce(__m128i acc)
+{
+    __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i k = _mm_set_epi64x(CLMUL_K4, CLMUL_K3);
+    __m128i poly = _mm_set_epi64x(CLMUL_MU, CLMUL_POLY);
+    __m128i tmp;
+
+    /* fold 128 bits to 64 bits */
+    tmp = _mm_clmulepi64_si128(acc, k, 0x10);
+    acc = _mm_xor_si128(_mm_srli_si128(acc, 8), tmp);
+    tmp = _mm_srli_si128(acc, 4);
+    acc = _mm_clmulepi64_si128(_mm_and_si128(acc, mask), _mm_set_epi64x(0, CLMUL_K5), 0x00);
+    acc = _mm_xor_si128(acc, tmp);
+
+    /* Barrett reduction of 64 bits to 32 bits */
+    tmp = _mm_clmulepi64_si128(_mm_and_si128(acc, mask), poly, 0x10);
+    tmp = _mm_clmulepi64_si128(_mm_and_si128(tmp, mask), poly, 0x00);
+    acc = _mm_xor_si128(acc, tmp);
+    return (uint32_t)_mm_extract_epi32(acc, 1);
+}
+
+/* Fold remaining 16-byte units into 128-bit accumulator, reduce it, and process up to
+   15 trailing bytes with the crc instruction. */
+CRC32C_TARGET("sse4.2,pclmul")
+static inline uint32_t clmul_finish(__m128i acc, buffer next, size_t len)
+{
+    __m128i k = _mm_set_epi64x(CLMUL_K4, CLMUL_K3);
+    while (len >= 16)
     {
-        crc0 = _mm_crc32_u32(crc0, *(const uint32_t *)(next));
-        next += 4;
+        acc = clmul_fold(acc, k, _mm_loadu_si128((const __m128i *)next));
+        next += 16;
+        len -= 16;
+    }
+    return crc32c_append_hw(clmul_reduce(acc) ^ 0xffffffff, next, len);
+}
+
+/* Compute CRC-32C by folding 64-byte blocks with carry-less multiplication.  Four
+   independent 128-bit accumulators hide the latency of PCLMULQDQ.  Short inputs and
+   the last few bytes that don't fill a 16-byte unit are handed over to the crc
+   instruction, which is available on every CPU that supports PCLMULQDQ. */
+CRC32C_TARGET("sse4.2,pclmul")
+CRC32C_API uint32_t crc32c_append_clmul(uint32_t crc, buffer buf, size_t len)
+{
+    buffer next = buf;
+    __m128i x0, x1, x2, x3, k;
+
+    if (len < CLMUL_MIN)
+        return crc32c_append_hw(crc, buf, len);
+
+    /* load the first block and put the pre-processed crc into its first four bytes */
+    x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)next), _mm_cvtsi32_si128((int)(crc ^ 0xffffffff)));
+    x1 = _mm_loadu_si128((const __m128i *)(next + 16));
+    x2 = _mm_loadu_si128((const __m128i *)(next + 32));
+    x3 = _mm_loadu_si128((const __m128i *)(next + 48));
+    next += 64;
+    len -= 64;
+
+    /* fold four accumulators over the following 64-byte blocks */
+    k = _mm_set_epi64x(CLMUL_K2, CLMUL_K1);
+    while (len >= 64)
+    {
+        x0 = clmul_fold(x0, k, _mm_loadu_si128((const __m128i *)next));
+        x1 = clmul_fold(x1, k, _mm_loadu_si128((const __m128i *)(next + 16)));
+        x2 = clmul_fold(x2, k, _mm_loadu_si128((const __m128i *)(next + 32)));
+        x3 = clmul_fold(x3, k, _mm_loadu_si128((const __m128i *)(next + 48)));
+        next += 64;
+        len -= 64;
+    }
+
+    /* fold the four accumulators into one */
+    k = _mm_set_epi64x(CLMUL_K4, CLMUL_K3);
+    x0 = clmul_fold(x0, k, x1);
+    x0 = clmul_fold(x0, k, x2);
+    x0 = clmul_fold(x0, k, x3);
+
+    return clmul_finish(x0, next, len);
+}
+
+/* Fold four 128-bit lanes of 512-bit accumulator over the distance encoded in k and add data. */
+CRC32C_TARGET("sse4.2,pclmul,avx512f,vpclmulqdq")
+static inline __m512i vpclmul_fold(__m512i acc, __m512i k, __m512i data)
+{
+    __m512i lower = _mm512_clmulepi64_epi128(acc, k, 0x00);
+    __m512i upper = _mm512_clmulepi64_epi128(acc, k, 0x11);
+    return _mm512_ternarylogic_epi64(lower, upper, data, 0x96);
+}
+
+/* Same as crc32c_append_clmul, but it folds 256-byte blocks using four 512-bit
+   accumulators with VPCLMULQDQ.  Inputs shorter than VPCLMUL_MIN are passed to
+   crc32c_append_clmul. */
+CRC32C_TARGET("sse4.2,pclmul,avx512f,vpclmulqdq")
+CRC32C_API uint32_t crc32c_append_vpclmul(uint32_t crc, buffer buf, size_t len)
+{
+    buffer next = buf;
+    __m512i z0, z1, z2, z3, k;
+    __m128i x0, x1, x2, x3, k128;
+
+    if (len < VPCLMUL_MIN)
+        return crc32c_append_clmul(crc, buf, len);
+
+    /* load the first block and put the pre-processed crc into its first four bytes */
+    z0 = _mm512_xor_si512(_mm512_loadu_si512(next), _mm512_zextsi128_si512(_mm_cvtsi32_si128((int)(crc ^ 0xffffffff))));
+    z1 = _mm512_loadu_si512(next + 64);
+    z2 = _mm512_loadu_si512(next + 128);
+    z3 = _mm512_loadu_si512(next + 192);
+    next += 256;
+    len -= 256;
+
+    /* fold four accumulators over the following 256-byte blocks */
+    k = _mm512_broadcast_i32x4(_mm_set_epi64x(VPCLMUL_K2, VPCLMUL_K1));
+    while (len >= 256)
+    {
+        z0 = vpclmul_fold(z0, k, _mm512_loadu_si512(next));
+        z1 = vpclmul_fold(z1, k, _mm512_loadu_si512(next + 64));
+        z2 = vpclmul_fold(z2, k, _mm512_loadu_si512(next + 128));
+        z3 = vpclmul_fold(z3, k, _mm512_loadu_si512(next + 192));
+        next += 256;
+        len -= 256;
+    }
+
+    /* fold the four accumulators into one and continue with remaining 64-byte blocks */
+    k = _mm512_broadcast_i32x4(_mm_set_epi64x(CLMUL_K2, CLMUL_K1));
+    z0 = vpclmul_fold(z0, k, z1);
+    z0 = vpclmul_fold(z0, k, z2);
+    z0 = vpclmul_fold(z0, k, z3);
+    while (len >= 64)
+    {
+        z0 = vpclmul_fold(z0, k, _mm512_loadu_si512(next));
+        next += 64;
+        len -= 64;
     }
+
+    /* fold the four 128-bit lanes of the accumulator into one */
+    k128 = _mm_set_epi64x(CLMUL_K4, CLMUL_K3);
+    x0 = _mm512_extracti32x4_epi32(z0, 0);
+    x1 = _mm512_extracti32x4_epi32(z0, 1);
+    x2 = _mm512_extracti32x4_epi32(z0, 2);
+    x3 = _mm512_extracti32x4_epi32(z0, 3);
+    x0 = clmul_fold(x0, k128, x1);
+    x0 = clmul_fold(x0, k128, x2);
+    x0 = clmul_fold(x0, k128, x3);
+
+    return clmul_finish(x0, next, len);
+}
+
+/* Compute crc of four consecutive streams of size bytes each.  The first three streams
+   go through the crc instruction like in crc32c_append_hw while the fourth stream is
+   folded with carry-less multiplication.  Both instructions execute on different ports,
+   so the fourth stream is almost free.  Partial crcs are merged with shift_table, which
+   must shift a crc by size zeros. */
+CRC32C_TARGET("sse4.2,pclmul")
+#ifdef CRC32C_X64
+static inline uint64_t hybrid_block(uint64_t crc0, buffer next, size_t size, uint32_t shift_table[][256])
+#else
+static inline uint32_t hybrid_block(uint32_t crc0, buffer next, size_t size, uint32_t shift_table[][256])
+#endif
+{
+#ifdef CRC32C_X64
+    uint64_t crc1 = 0, crc2 = 0;
+#else
+    uint32_t crc1 = 0, crc2 = 0;
+#endif
+    buffer folded = next + 3 * size;
+    buffer end = next + size;
+    __m128i x0, x1, x2, x3, k;
+    size_t i;
+
+    x0 = _mm_loadu_si128((const __m128i *)folded);
+    x1 = _mm_loadu_si128((const __m128i *)(folded + 16));
+    x2 = _mm_loadu_si128((const __m128i *)(folded + 32));
+    x3 = _mm_loadu_si128((const __m128i *)(folded + 48));
+    folded += 64;
+    k = _mm_set_epi64x(CLMUL_K2, CLMUL_K1);
+    do
+    {
+#ifdef CRC32C_X64
+        for (i = 0; i < 64; i += 8)
+        {
+            crc0 = _mm_crc32_u64(crc0, *(const uint64_t *)(next + i));
+            crc1 = _mm_crc32_u64(crc1, *(const uint64_t *)(next + size + i));
+            crc2 = _mm_crc32_u64(crc2, *(const uint64_t *)(next + 2 * size + i));
+        }
+#else
+        for (i = 0; i < 64; i += 4)
+        {
+            crc0 = _mm_crc32_u32(crc0, *(const uint32_t *)(next + i));
+            crc1 = _mm_crc32_u32(crc1, *(const uint32_t *)(next + size + i));
+            crc2 = _mm_crc32_u32(crc2, *(const uint32_t *)(next + 2 * size + i));
+        }
+#endif
+        next += 64;
+        if (next < end)
+        {
+            x0 = clmul_fold(x0, k, _mm_loadu_si128((const __m128i *)folded));
+            x1 = clmul_fold(x1, k, _mm_loadu_si128((const __m128i *)(folded + 16)));
+            x2 = clmul_fold(x2, k, _mm_loadu_si128((const __m128i *)(folded + 32)));
+            x3 = clmul_fold(x3, k, _mm_loadu_si128((const __m128i *)(folded + 48)));
+            folded += 64;
+        }
+    } while (next < end);
+
+    k = _mm_set_epi64x(CLMUL_K4, CLMUL_K3);
+    x0 = clmul_fold(x0, k, x1);
+    x0 = clmul_fold(x0, k, x2);
+    x0 = clmul_fold(x0, k, x3);
+
+    crc0 = shift_crc(shift_table, (uint32_t)(crc0)) ^ crc1;
+    crc0 = shift_crc(shift_table, (uint32_t)(crc0)) ^ crc2;
+    return shift_crc(shift_table, (uint32_t)(crc0)) ^ clmul_reduce(x0);
+}
+
+/* Compute CRC-32C using the crc instruction and carry-less multiplication in parallel.
+   Data is processed in blocks of four LONG_SHIFT or SHORT_SHIFT streams.  Whatever is
+   left over is passed to crc32c_append_hw. */
+CRC32C_TARGET("sse4.2,pclmul")
+CRC32C_API uint32_t crc32c_append_hybrid(uint32_t crc, buffer buf, size_t len)
+{
+    buffer next = buf;
+#ifdef CRC32C_X64
+    uint64_t crc0;
+#else
+    uint32_t crc0;
 #endif
-    len &= 7;
 
-    /* compute the crc for up to seven trailing bytes */
+    crc0 = crc ^ 0xffffffff;
+    while (len >= 4 * LONG_SHIFT)
+    {
+        crc0 = hybrid_block(crc0, next, LONG_SHIFT, long_shifts.dword_table);
+        next += 4 * LONG_SHIFT;
+        len -= 4 * LONG_SHIFT;
+    }
+    while (len >= 4 * SHORT_SHIFT)
+    {
+        crc0 = hybrid_block(crc0, next, SHORT_SHIFT, short_shifts.dword_table);
+        next += 4 * SHORT_SHIFT;
+        len -= 4 * SHORT_SHIFT;
+    }
+    return crc32c_append_hw((uint32_t)(crc0) ^ 0xffffffff, next, len);
+}
+
+/* Multiply a and b modulo P(x).  Both polynomials are bit-reflected, i.e. x^0 is the
+   most significant bit. */
+static uint32_t multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = (uint32_t)1 << 31;
+    uint32_t p = 0;
+    /* the loop below stops after the lowest set bit of a, so zero would never stop it */
+    if (a == 0)
+        return 0;
+    for (;;)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+    }
+    return p;
+}
+
+/* Compute operator x^(8*len) mod P(x) by multiplying zeros_ops for every bit of len. */
+static uint32_t zeros_op(size_t len)
+{
+    uint32_t op = (uint32_t)1 << 31;
+    int k = 0;
     while (len)
     {
-        crc0 = _mm_crc32_u8((uint32_t)(crc0), *next);
-        ++next;
-        --len;
+        if (len & 1)
+            op = multmodp(zeros_ops[k], op);
+        len >>= 1;
+        ++k;
     }
+    return op;
+}
+
+CRC32C_API uint32_t crc32c_append_zeros(uint32_t crc, size_t length)
+{
+    return multmodp(zeros_op(length), crc ^ 0xffffffff) ^ 0xffffffff;
+}
+
+CRC32C_API uint32_t crc32c_combine_gen(size_t length)
+{
+    return zeros_op(length);
+}
+
+CRC32C_API uint32_t crc32c_combine_op(uint32_t crc1, uint32_t crc2, uint32_t op)
+{
+    return multmodp(op, crc1) ^ crc2;
+}
+
+CRC32C_API uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t length2)
+{
+    return multmodp(zeros_op(length2), crc1) ^ crc2;
+}
+
+/* CRC is linear, so patching bytes changes it by CRC of the difference between old and new content,
+   which is zero everywhere except in the patched region.  Only the region is read.  Its crc is
+   computed from zero register, i.e. without the pre- and post-conditioning, and shifted over
+   the bytes that follow it.  Leading zeros don't change crc computed from zero register. */
+CRC32C_API uint32_t crc32c_update(uint32_t crc, size_t length, size_t offset, buffer old_bytes, buffer new_bytes, size_t count)
+{
+    uint8_t delta[256];
+    uint32_t diff = 0xffffffff;
+    size_t done, chunk, i;
 
-    /* return a post-processed crc */
-    return (uint32_t)(crc0) ^ 0xffffffff;
+    for (done = 0; done < count; done += chunk)
+    {
+        chunk = count - done < sizeof(delta) ? count - done : sizeof(delta);
+        for (i = 0; i < chunk; ++i)
+            delta[i] = old_bytes[done + i] ^ new_bytes[done + i];
+        diff = crc32c_append(diff, delta, chunk);
+    }
+    return multmodp(zeros_op(length - offset - count), diff ^ 0xffffffff) ^ crc;
 }
 
 CRC32C_API int crc32c_hw_available()
@@ -1069,23 +1594,1153 @@ CRC32C_API int crc32c_hw_available()
     return (info[2] & (1 << 20)) != 0;
 }
 
-uint32_t(*append_func)(uint32_t, buffer, size_t)
-#ifdef __cplusplus
-    = crc32c_hw_available() ? crc32c_append_hw : crc32c_append_sw;
+CRC32C_API int crc32c_clmul_available()
+{
+    int info[4];
+#ifdef CRC32C_GCC
+    __cpuid(1, info[0], info[1], info[2], info[3]);
 #else
-    = crc32c_append_sw;
+    __cpuid(info, 1);
 #endif
+    return (info[2] & (1 << 20)) != 0 && (info[2] & (1 << 1)) != 0;
+}
 
-#ifndef __cplusplus
-CRC32C_API void crc32c_init()
+CRC32C_API int crc32c_vpclmul_available()
+{
+    int info[4];
+    uint64_t xcr0;
+    if (!crc32c_clmul_available())
+        return 0;
+#ifdef CRC32C_GCC
+    __cpuid(1, info[0], info[1], info[2], info[3]);
+#else
+    __cpuid(info, 1);
+#endif
+    /* OS must save AVX-512 state (opmask, upper halves of zmm0-15, and zmm16-31) */
+    if ((info[2] & (1 << 27)) == 0)
+        return 0;
+#ifdef CRC32C_GCC
+    {
+        uint32_t eax, edx;
+        __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        xcr0 = ((uint64_t)edx << 32) | eax;
+    }
+    __cpuid_count(7, 0, info[0], info[1], info[2], info[3]);
+#else
+    xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+#endif
+    if ((xcr0 & 0xe6) != 0xe6)
+        return 0;
+    return (info[1] & (1 << 16)) != 0 && (info[2] & (1 << 10)) != 0;
+}
+
+#define CRC32C_STRING(value) #value
+#define CRC32C_EXPAND_STRING(value) CRC32C_STRING(value)
+
+CRC32C_API const char *crc32c_build_isa()
+{
+#ifdef CRC32C_X64
+    return "x86-64 (crc32q, slice-by-" CRC32C_EXPAND_STRING(CRC32C_SW_SLICES) ")";
+#else
+    return "x86 (crc32l, slice-by-" CRC32C_EXPAND_STRING(CRC32C_SW_SLICES) ")";
+#endif
+}
+
+typedef uint32_t(*append_kernel)(uint32_t, buffer, size_t);
+
+/* Kernels that can be pinned with CRC32C_KERNEL environment variable.  Calibration compares
+   only candidates, because the remaining kernels are either never the fastest or not a kernel at all. */
+static const struct
+{
+    const char *name;
+    append_kernel kernel;
+    int(*available)();
+    int candidate;
+} kernels[] = {
+    { "sw", crc32c_append_sw, NULL, 1 },
+    { "braided", crc32c_append_braided, NULL, 1 },
+    { "hw", crc32c_append_hw, crc32c_hw_available, 1 },
+    { "hybrid", crc32c_append_hybrid, crc32c_clmul_available, 1 },
+    { "clmul", crc32c_append_clmul, crc32c_clmul_available, 1 },
+    { "vpclmul", crc32c_append_vpclmul, crc32c_vpclmul_available, 1 },
+    { "sw4", crc32c_append_sw4, NULL, 0 },
+    { "sw8", crc32c_append_sw8, NULL, 0 },
+    { "sw16", crc32c_append_sw16, NULL, 0 },
+    { "calibrated", crc32c_append_calibrated, NULL, 0 }
+};
+
+#define KERNEL_COUNT (sizeof(kernels) / sizeof(kernels[0]))
+
+/* Compare strings without the C library, which might not be initialized yet. */
+static int env_equals(const char *value, const char *expected, char terminator)
 {
-    if (crc32c_hw_available()) {
-        append_func = crc32c_append_hw;
+    while (*expected && *value == *expected)
+    {
+        ++value;
+        ++expected;
     }
+    return !*expected && *value == terminator;
+}
+
+/* GNU ifunc lets the dynamic linker bind crc32c_append directly to the selected kernel
+   while the program is being loaded.  The resolver runs before the C library is
+   initialized, so it reads the environment directly. */
+#if defined(CRC32C_GCC) && defined(__ELF__) && defined(__GLIBC__) && !defined(CRC32C_NO_IFUNC)
+#define CRC32C_IFUNC
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern char **environ;
+extern void *__libc_stack_end;
+#ifdef __cplusplus
 }
 #endif
 
-CRC32C_API uint32_t crc32c_append(uint32_t crc, buffer input, size_t length)
+static const char *kernel_env()
+{
+    char **env = environ;
+    char **var;
+    /* environ is not set yet when resolving symbols of dynamically linked programs,
+       but the initial process stack holds argc, argv, and the environment */
+    if (!env && __libc_stack_end)
+    {
+        uintptr_t *stack = (uintptr_t *)__libc_stack_end;
+        env = (char **)(stack + 1 + stack[0] + 1);
+    }
+    if (!env)
+        return NULL;
+    for (var = env; *var; ++var)
+        if (env_equals(*var, "CRC32C_KERNEL", '='))
+            return *var + sizeof("CRC32C_KERNEL");
+    return NULL;
+}
+#else
+static const char *kernel_env()
+{
+    return getenv("CRC32C_KERNEL");
+}
+#endif
+
+/* Pick kernel named in CRC32C_KERNEL if it is set and supported by the CPU, or the fastest
+   available kernel otherwise.  Three crc instruction streams outrun 128-bit carry-less
+   multiplication on CPUs without VPCLMULQDQ, so crc32c_append_clmul is only chosen
+   by calibration where it measurably wins. */
+static append_kernel automatic_kernel()
+{
+    if (crc32c_vpclmul_available())
+        return crc32c_append_vpclmul;
+    if (crc32c_hw_available())
+        return crc32c_append_hw;
+    /* braided kernel always needs slice-by-16 and shift tables, which would override CRC32C_SW_SLICES */
+    return crc32c_append_sw;
+}
+
+static append_kernel select_kernel()
+{
+    const char *pinned = kernel_env();
+    size_t i;
+    if (pinned)
+    {
+        for (i = 0; i < KERNEL_COUNT; ++i)
+            if (env_equals(pinned, kernels[i].name, 0) && (!kernels[i].available || kernels[i].available()))
+                return kernels[i].kernel;
+    }
+    return automatic_kernel();
+}
+
+/* Pointers selected at run time and shared by all threads.  Loads acquire and stores release,
+   so that tables published through a pointer are complete when readers see it, and
+   PUBLISH_POINTER stores into a null pointer and returns the previous value.  Flags are
+   int values computed once, which need no ordering, so their loads and stores are relaxed. */
+#ifdef CRC32C_GCC
+#define LOAD_POINTER(pointer) __atomic_load_n(&(pointer), __ATOMIC_ACQUIRE)
+#define STORE_POINTER(pointer, value) __atomic_store_n(&(pointer), value, __ATOMIC_RELEASE)
+#define PUBLISH_POINTER(pointer, value) __sync_val_compare_and_swap(&(pointer), NULL, value)
+#define LOAD_FLAG(flag) __atomic_load_n(&(flag), __ATOMIC_RELAXED)
+#define STORE_FLAG(flag, value) __atomic_store_n(&(flag), value, __ATOMIC_RELAXED)
+#else
+#define LOAD_POINTER(pointer) InterlockedCompareExchangePointer((PVOID volatile *)&(pointer), NULL, NULL)
+#define STORE_POINTER(pointer, value) InterlockedExchangePointer((PVOID volatile *)&(pointer), (PVOID)(value))
+#define PUBLISH_POINTER(pointer, value) InterlockedCompareExchangePointer((PVOID volatile *)&(pointer), (PVOID)(value), NULL)
+#define LOAD_FLAG(flag) (*(volatile int *)&(flag))
+#define STORE_FLAG(flag, value) InterlockedExchange((volatile LONG *)&(flag), value)
+#endif
+
+static uint32_t append_resolve(uint32_t crc, buffer input, size_t length);
+
+/* Selected kernel.  It is statically initialized to a trampoline that selects the kernel on
+   first use, so there is no dependency on static initialization order.  Concurrent first
+   calls may all select the kernel, but they all store the same value. */
+static append_kernel append_func = append_resolve;
+
+
+static append_kernel resolve_kernel()
+{
+    append_kernel kernel = (append_kernel)LOAD_POINTER(append_func);
+    if (kernel == append_resolve)
+    {
+        kernel = select_kernel();
+        STORE_POINTER(append_func, kernel);
+    }
+    return kernel;
+}
+
+static uint32_t append_resolve(uint32_t crc, buffer input, size_t length)
+{
+    return resolve_kernel()(crc, input, length);
+}
+
+CRC32C_API void crc32c_init()
+{
+    resolve_kernel();
+}
+
+#ifdef CRC32C_IFUNC
+#ifdef __cplusplus
+extern "C" {
+#endif
+static append_kernel crc32c_append_resolver()
+{
+    return resolve_kernel();
+}
+#ifdef __cplusplus
+}
+#endif
+
+CRC32C_API uint32_t crc32c_append(uint32_t crc, buffer input, size_t length) __attribute__((ifunc("crc32c_append_resolver")));
+#else
+CRC32C_API uint32_t crc32c_append(uint32_t crc, buffer input, size_t length)
+{
+	return ((append_kernel)LOAD_POINTER(append_func))(crc, input, length);
+}
+#endif
+
+/* Calibration compares available kernels on inputs of these sizes. */
+static const size_t calibration_sizes[] = { 16, 64, 256, 1024, 4096, 16384, 65536, 262144 };
+#define CALIBRATION_SIZES (sizeof(calibration_sizes) / sizeof(calibration_sizes[0]))
+#define CALIBRATION_BYTES (1024 * 1024)
+#define CALIBRATION_TRIALS 3
+#define CALIBRATION_VERSION 1
+
+/* Kernels chosen by calibration for tiny, medium, and large inputs as indexes into kernels[]. */
+struct size_classes
+{
+    size_t medium_min;
+    size_t large_min;
+    size_t tiny;
+    size_t medium;
+    size_t large;
+};
+
+static struct size_classes *calibration = NULL;
+
+static uint64_t clock_ns()
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)(counter.QuadPart * (1000000000.0 / frequency.QuadPart));
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+/* Best time in nanoseconds to process CALIBRATION_BYTES in pieces of given size.  Every call
+   depends on the previous one and starts at different alignment like in real streams. */
+static uint64_t measure_kernel(append_kernel kernel, buffer input, size_t size)
+{
+    uint64_t best = UINT64_MAX;
+    size_t calls = CALIBRATION_BYTES / size;
+    uint32_t crc = 0;
+    int trial;
+    size_t i;
+    for (trial = 0; trial < CALIBRATION_TRIALS; ++trial)
+    {
+        uint64_t start = clock_ns(), time;
+        for (i = 0; i < calls; ++i)
+            crc = kernel(crc, input + (crc & 63), size);
+        time = clock_ns() - start;
+        if (time < best)
+            best = time;
+    }
+    return best;
+}
+
+/* Class boundary halfway between the size where the previous kernel won and the size where the next kernel won. */
+static size_t class_boundary(size_t index)
+{
+    return index ? (calibration_sizes[index - 1] + calibration_sizes[index]) / 2 : 0;
+}
+
+static void measure_classes(struct size_classes *classes)
+{
+    size_t winners[CALIBRATION_SIZES];
+    size_t s, k, first_other, large_start;
+    uint8_t *input = (uint8_t *)malloc(calibration_sizes[CALIBRATION_SIZES - 1] + 64);
+    if (!input)
+    {
+        /* nothing to measure on, so every class gets the kernel automatic dispatch would pick */
+        for (k = 0; k < KERNEL_COUNT && kernels[k].kernel != automatic_kernel(); ++k);
+        classes->tiny = classes->medium = classes->large = k;
+        classes->medium_min = classes->large_min = 0;
+        return;
+    }
+    for (s = 0; s < calibration_sizes[CALIBRATION_SIZES - 1] + 64; ++s)
+        input[s] = (uint8_t)(s * 0x9e3779b1 >> 24);
+    for (s = 0; s < CALIBRATION_SIZES; ++s)
+    {
+        uint64_t best = UINT64_MAX, time;
+        winners[s] = 0;
+        for (k = 0; k < KERNEL_COUNT; ++k)
+        {
+            if (!kernels[k].candidate || (kernels[k].available && !kernels[k].available()))
+                continue;
+            time = measure_kernel(kernels[k].kernel, input, calibration_sizes[s]);
+            if (time < best)
+            {
+                best = time;
+                winners[s] = k;
+            }
+        }
+    }
+    free(input);
+
+    /* tiny kernel wins on the smallest inputs, large kernel wins consistently from some size up,
+       and whatever wins first in between is the medium kernel */
+    classes->tiny = winners[0];
+    classes->large = winners[CALIBRATION_SIZES - 1];
+    for (first_other = 0; first_other < CALIBRATION_SIZES && winners[first_other] == classes->tiny; ++first_other);
+    for (large_start = CALIBRATION_SIZES - 1; large_start > 0 && winners[large_start - 1] == classes->large; --large_start);
+    classes->large_min = class_boundary(large_start);
+    if (first_other < large_start)
+    {
+        classes->medium = winners[first_other];
+        classes->medium_min = class_boundary(first_other);
+    }
+    else
+    {
+        classes->medium = classes->large;
+        classes->medium_min = classes->large_min;
+    }
+}
+
+/* Cached calibration is valid only on the same CPU model, which is identified by vendor and family/model/stepping. */
+static void cpu_signature(char *signature)
+{
+    int info[4], vendor[4];
+#ifdef CRC32C_GCC
+    __cpuid(0, vendor[0], vendor[1], vendor[2], vendor[3]);
+    __cpuid(1, info[0], info[1], info[2], info[3]);
+#else
+    __cpuid(vendor, 0);
+    __cpuid(info, 1);
+#endif
+    sprintf(signature, "%08x%08x%08x%08x", (uint32_t)vendor[1], (uint32_t)vendor[3], (uint32_t)vendor[2], (uint32_t)info[0]);
+}
+
+static int find_kernel(const char *name, size_t *index)
+{
+    size_t k;
+    for (k = 0; k < KERNEL_COUNT; ++k)
+    {
+        if (kernels[k].candidate && strcmp(name, kernels[k].name) == 0)
+        {
+            *index = k;
+            return !kernels[k].available || kernels[k].available();
+        }
+    }
+    return 0;
+}
+
+static int load_classes(const char *path, struct size_classes *classes)
+{
+    char signature[33], cached[33], tiny[16], medium[16], large[16];
+    unsigned long medium_min, large_min;
+    int version, valid;
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return 0;
+    valid = fscanf(file, "crc32c-calibration %d %32s %15s %lu %15s %lu %15s", &version, cached, tiny, &medium_min, medium, &large_min, large) == 7;
+    fclose(file);
+    cpu_signature(signature);
+    if (!valid || version != CALIBRATION_VERSION || strcmp(signature, cached) != 0)
+        return 0;
+    if (!find_kernel(tiny, &classes->tiny) || !find_kernel(medium, &classes->medium) || !find_kernel(large, &classes->large))
+        return 0;
+    classes->medium_min = medium_min;
+    classes->large_min = large_min;
+    return 1;
+}
+
+static void save_classes(const char *path, const struct size_classes *classes)
+{
+    char signature[33];
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return;
+    cpu_signature(signature);
+    fprintf(file, "crc32c-calibration %d %s %s %lu %s %lu %s\n", CALIBRATION_VERSION, signature,
+        kernels[classes->tiny].name, (unsigned long)classes->medium_min,
+        kernels[classes->medium].name, (unsigned long)classes->large_min,
+        kernels[classes->large].name);
+    fclose(file);
+}
+
+static int calibrate(const char *cache, struct size_classes *classes)
+{
+    if (cache && load_classes(cache, classes))
+        return 1;
+    measure_classes(classes);
+    if (cache)
+        save_classes(cache, classes);
+    return 0;
+}
+
+/* Calibrates on first use.  Returns NULL when out of memory, in which case callers use automatic dispatch. */
+static const struct size_classes *calibrated_classes()
+{
+    struct size_classes *classes = (struct size_classes *)LOAD_POINTER(calibration);
+    if (!classes)
+    {
+        struct size_classes *previous;
+        classes = (struct size_classes *)malloc(sizeof(struct size_classes));
+        if (!classes)
+            return NULL;
+        calibrate(getenv("CRC32C_CALIBRATION"), classes);
+        /* concurrent first calls might have calibrated too, in which case the first result wins */
+        previous = (struct size_classes *)PUBLISH_POINTER(calibration, classes);
+        if (previous)
+        {
+            free(classes);
+            classes = previous;
+        }
+    }
+    return classes;
+}
+
+CRC32C_API int crc32c_calibrate(const char *cache)
+{
+    struct size_classes *classes = (struct size_classes *)malloc(sizeof(struct size_classes));
+    int cached;
+    /* lazy calibration will try again on first use */
+    if (!classes)
+        return 0;
+    cached = calibrate(cache, classes);
+    /* previous table is leaked, because concurrent calls might still be reading it */
+    STORE_POINTER(calibration, classes);
+    return cached;
+}
+
+CRC32C_API uint32_t crc32c_append_calibrated(uint32_t crc, buffer input, size_t length)
+{
+    const struct size_classes *classes = calibrated_classes();
+    if (!classes)
+        return automatic_kernel()(crc, input, length);
+    if (length < classes->medium_min)
+        return kernels[classes->tiny].kernel(crc, input, length);
+    if (length < classes->large_min)
+        return kernels[classes->medium].kernel(crc, input, length);
+    return kernels[classes->large].kernel(crc, input, length);
+}
+
+/* Kernels that need CPU support all imply the crc instruction, software ones don't. */
+static int hardware_kernel(append_kernel kernel)
+{
+    size_t k;
+    for (k = 0; k < KERNEL_COUNT && kernels[k].kernel != kernel; ++k);
+    return k < KERNEL_COUNT && kernels[k].available;
+}
+
+/* Check whether the selected kernel uses the crc instruction without the cost of cpuid.
+   Calibrated dispatch is represented by its tiny kernel, because callers process short inputs. */
+static int selected_hw()
+{
+    append_kernel kernel = resolve_kernel();
+    const struct size_classes *classes;
+    if (kernel == crc32c_append_calibrated)
+    {
+        classes = calibrated_classes();
+        kernel = classes ? kernels[classes->tiny].kernel : automatic_kernel();
+    }
+    return hardware_kernel(kernel);
+}
+
+#ifdef CRC32C_X64
+/* Compute crc of three independent messages with interleaved crc instructions.  All three
+   messages are processed together while the shortest one lasts, then the remaining two,
+   and the rest of the longest message, which might be long, is left to crc32c_append_hw. */
+static void append_batch3_hw(buffer *bufs, const size_t *lens, uint32_t *crcs)
+{
+    int a = 0, b = 1, c = 2, t;
+    uint64_t crc0, crc1, crc2;
+    buffer next0, next1, next2, end;
+    size_t done;
+
+    /* sort the messages by length, so that a is the shortest and c the longest */
+    if (lens[a] > lens[b]) { t = a; a = b; b = t; }
+    if (lens[b] > lens[c]) { t = b; b = c; c = t; }
+    if (lens[a] > lens[b]) { t = a; a = b; b = t; }
+
+    crc0 = crcs[a] ^ 0xffffffff;
+    crc1 = crcs[b] ^ 0xffffffff;
+    crc2 = crcs[c] ^ 0xffffffff;
+    next0 = bufs[a];
+    next1 = bufs[b];
+    next2 = bufs[c];
+
+    end = next0 + (lens[a] & ~(size_t)7);
+    while (next0 < end)
+    {
+        crc0 = _mm_crc32_u64(crc0, *(const uint64_t *)next0);
+        crc1 = _mm_crc32_u64(crc1, *(const uint64_t *)next1);
+        crc2 = _mm_crc32_u64(crc2, *(const uint64_t *)next2);
+        next0 += 8;
+        next1 += 8;
+        next2 += 8;
+    }
+    done = next1 - bufs[b];
+    end = next1 + ((lens[b] - done) & ~(size_t)7);
+    while (next1 < end)
+    {
+        crc1 = _mm_crc32_u64(crc1, *(const uint64_t *)next1);
+        crc2 = _mm_crc32_u64(crc2, *(const uint64_t *)next2);
+        next1 += 8;
+        next2 += 8;
+    }
+
+    crcs[a] = (uint32_t)append_unaligned_hw(crc0, next0, lens[a] - (next0 - bufs[a])) ^ 0xffffffff;
+    crcs[b] = (uint32_t)append_unaligned_hw(crc1, next1, lens[b] - (next1 - bufs[b])) ^ 0xffffffff;
+    crcs[c] = crc32c_append_hw((uint32_t)crc2 ^ 0xffffffff, next2, lens[c] - (next2 - bufs[c]));
+}
+#endif
+
+CRC32C_API void crc32c_append_batch(const uint8_t **bufs, const size_t *lens, uint32_t *crcs, size_t count)
+{
+    size_t i = 0;
+#ifdef CRC32C_X64
+    if (selected_hw())
+    {
+        for (; i + 3 <= count; i += 3)
+            append_batch3_hw(bufs + i, lens + i, crcs + i);
+    }
+#endif
+    for (; i < count; ++i)
+        crcs[i] = crc32c_append(crcs[i], bufs[i], lens[i]);
+}
+
+/* Shared state of one crc32c_append_parallel call.  Every task computes crc of one part
+   starting from zero and the parts are merged afterwards. */
+struct parallel_job
+{
+    buffer input;
+    size_t length;
+    size_t part;
+    size_t tasks;
+    uint32_t *crcs;
+};
+
+static void parallel_task(void *context, size_t index)
+{
+    struct parallel_job *job = (struct parallel_job *)context;
+    size_t offset = index * job->part;
+    size_t length = index + 1 < job->tasks ? job->part : job->length - offset;
+    job->crcs[index] = crc32c_append(0, job->input + offset, length);
+}
+
+struct parallel_thread
+{
+    crc32c_task task;
+    void *context;
+    size_t index;
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    int started;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI parallel_thread_main(LPVOID arg)
+#else
+static void *parallel_thread_main(void *arg)
+#endif
+{
+    struct parallel_thread *thread = (struct parallel_thread *)arg;
+    thread->task(thread->context, thread->index);
+    return 0;
+}
+
+/* Default executor that starts a thread for every task except the first one, which runs
+   on the calling thread.  Tasks that cannot get a thread run on the calling thread too. */
+static void thread_executor(void *executor, crc32c_task task, void *context, size_t count)
+{
+    struct parallel_thread *threads = (struct parallel_thread *)calloc(count, sizeof(struct parallel_thread));
+    size_t i;
+    (void)executor;
+    if (!threads)
+    {
+        for (i = 0; i < count; ++i)
+            task(context, i);
+        return;
+    }
+    for (i = 1; i < count; ++i)
+    {
+        threads[i].task = task;
+        threads[i].context = context;
+        threads[i].index = i;
+#ifdef _WIN32
+        threads[i].handle = CreateThread(NULL, 0, parallel_thread_main, &threads[i], 0, NULL);
+        threads[i].started = threads[i].handle != NULL;
+#else
+        threads[i].started = pthread_create(&threads[i].handle, NULL, parallel_thread_main, &threads[i]) == 0;
+#endif
+    }
+    task(context, 0);
+    for (i = 1; i < count; ++i)
+    {
+        if (threads[i].started)
+        {
+#ifdef _WIN32
+            WaitForSingleObject(threads[i].handle, INFINITE);
+            CloseHandle(threads[i].handle);
+#else
+            pthread_join(threads[i].handle, NULL);
+#endif
+        }
+        else
+            task(context, i);
+    }
+    free(threads);
+}
+
+static int processor_count()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+CRC32C_API uint32_t crc32c_append_parallel_with(uint32_t crc, buffer input, size_t length, size_t tasks, crc32c_executor executor, void *executor_context)
+{
+    struct parallel_job job;
+    uint32_t op;
+    size_t i, last;
+
+    if (tasks > length / PARALLEL_MIN)
+        tasks = length / PARALLEL_MIN;
+    if (tasks <= 1)
+        return crc32c_append(crc, input, length);
+    job.crcs = (uint32_t *)malloc(tasks * sizeof(uint32_t));
+    if (!job.crcs)
+        return crc32c_append(crc, input, length);
+    job.input = input;
+    job.length = length;
+    job.part = length / tasks;
+    job.tasks = tasks;
+    executor(executor_context, parallel_task, &job, tasks);
+
+    /* all parts but the last one have the same length and can share one zeros operator */
+    op = crc32c_combine_gen(job.part);
+    for (i = 0; i + 1 < tasks; ++i)
+        crc = crc32c_combine_op(crc, job.crcs[i], op);
+    last = length - (tasks - 1) * job.part;
+    crc = crc32c_combine(crc, job.crcs[tasks - 1], last);
+    free(job.crcs);
+    return crc;
+}
+
+CRC32C_API uint32_t crc32c_append_parallel(uint32_t crc, buffer input, size_t length, int threads)
+{
+    if (threads <= 0)
+        threads = processor_count();
+    return crc32c_append_parallel_with(crc, input, length, (size_t)threads, thread_executor, NULL);
+}
+
+/* Carry-less multiplication support of the CPU.  It is checked only once, because cpuid is slow in virtual machines. */
+static int clmul_support = -1;
+
+static int clmul_supported()
+{
+    int supported = LOAD_FLAG(clmul_support);
+    if (supported < 0)
+    {
+        supported = crc32c_clmul_available();
+        STORE_FLAG(clmul_support, supported);
+    }
+    return supported;
+}
+
+/* Width of stream accumulators for the selected kernel: 256 bytes of 512-bit lanes for
+   crc32c_append_vpclmul, 64 bytes of 128-bit lanes for the other hardware kernels, and none
+   for software kernels, which are then simply called on every piece.  The crc instruction
+   could carry its three interleaved streams between pieces only by buffering three long
+   blocks, so kernels built on it fold with carry-less multiplication here.  Calibrated
+   dispatch is represented by its large kernel, because streams are long. */
+static int stream_block()
+{
+    append_kernel kernel = resolve_kernel();
+    const struct size_classes *classes;
+    if (kernel == crc32c_append_calibrated)
+    {
+        classes = calibrated_classes();
+        kernel = classes ? kernels[classes->large].kernel : automatic_kernel();
+    }
+    if (kernel == crc32c_append_vpclmul)
+        return 256;
+    if (hardware_kernel(kernel) && clmul_supported())
+        return 64;
+    return 0;
+}
+
+CRC32C_TARGET("sse4.2,pclmul")
+static void stream_fold_clmul(uint8_t *lanes, buffer next, size_t blocks)
+{
+    __m128i x0, x1, x2, x3, k;
+    x0 = _mm_loadu_si128((const __m128i *)lanes);
+    x1 = _mm_loadu_si128((const __m128i *)(lanes + 16));
+    x2 = _mm_loadu_si128((const __m128i *)(lanes + 32));
+    x3 = _mm_loadu_si128((const __m128i *)(lanes + 48));
+    k = _mm_set_epi64x(CLMUL_K2, CLMUL_K1);
+    for (; blocks; --blocks)
+    {
+        x0 = clmul_fold(x0, k, _mm_loadu_si128((const __m128i *)next));
+        x1 = clmul_fold(x1, k, _mm_loadu_si128((const __m128i *)(next + 16)));
+        x2 = clmul_fold(x2, k, _mm_loadu_si128((const __m128i *)(next + 32)));
+        x3 = clmul_fold(x3, k, _mm_loadu_si128((const __m128i *)(next + 48)));
+        next += 64;
+    }
+    _mm_storeu_si128((__m128i *)lanes, x0);
+    _mm_storeu_si128((__m128i *)(lanes + 16), x1);
+    _mm_storeu_si128((__m128i *)(lanes + 32), x2);
+    _mm_storeu_si128((__m128i *)(lanes + 48), x3);
+}
+
+CRC32C_TARGET("sse4.2,pclmul,avx512f,vpclmulqdq")
+static void stream_fold_vpclmul(uint8_t *lanes, buffer next, size_t blocks)
+{
+    __m512i z0, z1, z2, z3, k;
+    z0 = _mm512_loadu_si512(lanes);
+    z1 = _mm512_loadu_si512(lanes + 64);
+    z2 = _mm512_loadu_si512(lanes + 128);
+    z3 = _mm512_loadu_si512(lanes + 192);
+    k = _mm512_broadcast_i32x4(_mm_set_epi64x(VPCLMUL_K2, VPCLMUL_K1));
+    for (; blocks; --blocks)
+    {
+        z0 = vpclmul_fold(z0, k, _mm512_loadu_si512(next));
+        z1 = vpclmul_fold(z1, k, _mm512_loadu_si512(next + 64));
+        z2 = vpclmul_fold(z2, k, _mm512_loadu_si512(next + 128));
+        z3 = vpclmul_fold(z3, k, _mm512_loadu_si512(next + 192));
+        next += 256;
+    }
+    _mm512_storeu_si512(lanes, z0);
+    _mm512_storeu_si512(lanes + 64, z1);
+    _mm512_storeu_si512(lanes + 128, z2);
+    _mm512_storeu_si512(lanes + 192, z3);
+}
+
+static void stream_fold(crc32c_stream *stream, buffer next, size_t blocks)
+{
+    if (!blocks)
+        return;
+    if (stream->block == 256)
+        stream_fold_vpclmul(stream->lanes, next, blocks);
+    else
+        stream_fold_clmul(stream->lanes, next, blocks);
+}
+
+/* Fold the accumulators into one like crc32c_append_clmul does and finish it with pending bytes. */
+CRC32C_TARGET("sse4.2,pclmul")
+static uint32_t stream_finish_clmul(const crc32c_stream *stream)
+{
+    __m128i x0, k;
+    k = _mm_set_epi64x(CLMUL_K4, CLMUL_K3);
+    x0 = _mm_loadu_si128((const __m128i *)stream->lanes);
+    x0 = clmul_fold(x0, k, _mm_loadu_si128((const __m128i *)(stream->lanes + 16)));
+    x0 = clmul_fold(x0, k, _mm_loadu_si128((const __m128i *)(stream->lanes + 32)));
+    x0 = clmul_fold(x0, k, _mm_loadu_si128((const __m128i *)(stream->lanes + 48)));
+    return clmul_finish(x0, stream->pending, stream->pending_length);
+}
+
+/* Fold the accumulators into one like crc32c_append_vpclmul does and finish it with pending bytes. */
+CRC32C_TARGET("sse4.2,pclmul,avx512f,vpclmulqdq")
+static uint32_t stream_finish_vpclmul(const crc32c_stream *stream)
+{
+    __m512i z0, k;
+    __m128i x0, k128;
+    k = _mm512_broadcast_i32x4(_mm_set_epi64x(CLMUL_K2, CLMUL_K1));
+    z0 = _mm512_loadu_si512(stream->lanes);
+    z0 = vpclmul_fold(z0, k, _mm512_loadu_si512(stream->lanes + 64));
+    z0 = vpclmul_fold(z0, k, _mm512_loadu_si512(stream->lanes + 128));
+    z0 = vpclmul_fold(z0, k, _mm512_loadu_si512(stream->lanes + 192));
+    k128 = _mm_set_epi64x(CLMUL_K4, CLMUL_K3);
+    x0 = _mm512_extracti32x4_epi32(z0, 0);
+    x0 = clmul_fold(x0, k128, _mm512_extracti32x4_epi32(z0, 1));
+    x0 = clmul_fold(x0, k128, _mm512_extracti32x4_epi32(z0, 2));
+    x0 = clmul_fold(x0, k128, _mm512_extracti32x4_epi32(z0, 3));
+    return clmul_finish(x0, stream->pending, stream->pending_length);
+}
+
+CRC32C_API void crc32c_stream_init(crc32c_stream *stream, uint32_t crc)
+{
+    stream->crc = crc;
+    stream->pending_length = 0;
+    stream->block = 0;
+    stream->target = 0;
+    stream->length = 0;
+}
+
+CRC32C_API uint32_t crc32c_stream_value(const crc32c_stream *stream)
+{
+    if (stream->block == 256)
+        return stream_finish_vpclmul(stream);
+    if (stream->block == 64)
+        return stream_finish_clmul(stream);
+    return crc32c_append(stream->crc, stream->pending, stream->pending_length);
+}
+
+CRC32C_API void crc32c_stream_append(crc32c_stream *stream, buffer input, size_t length)
+{
+    size_t fill;
+    uint32_t first;
+
+    stream->length += length;
+    if (!stream->block)
+    {
+        int block = stream_block();
+        if (!block)
+        {
+            stream->crc = crc32c_append(stream->crc, input, length);
+            return;
+        }
+
+        /* short streams are buffered, because the crc instruction alone is faster for them */
+        fill = sizeof(stream->pending) - stream->pending_length;
+        if (fill > length)
+            fill = length;
+        memcpy(stream->pending + stream->pending_length, input, fill);
+        stream->pending_length += (uint32_t)fill;
+        input += fill;
+        length -= fill;
+        if (stream->pending_length < sizeof(stream->pending))
+            return;
+
+        /* 512-bit lanes wait for VPCLMUL_MIN bytes like crc32c_append_vpclmul does */
+        stream->target = block;
+        if (block > 64)
+            block = 64;
+        /* the first block initializes the accumulators with pre-processed crc in its first four bytes */
+        memcpy(stream->lanes, stream->pending, block);
+        memcpy(&first, stream->lanes, 4);
+        first ^= stream->crc ^ 0xffffffff;
+        memcpy(stream->lanes, &first, 4);
+        stream->block = block;
+        stream_fold(stream, stream->pending + block, sizeof(stream->pending) / block - 1);
+        stream->pending_length = 0;
+    }
+    else if (stream->pending_length)
+    {
+        /* complete the pending block */
+        fill = stream->block - stream->pending_length;
+        if (fill > length)
+            fill = length;
+        memcpy(stream->pending + stream->pending_length, input, fill);
+        stream->pending_length += (uint32_t)fill;
+        input += fill;
+        length -= fill;
+        if (stream->pending_length < (uint32_t)stream->block)
+            return;
+        stream_fold(stream, stream->pending, 1);
+        stream->pending_length = 0;
+    }
+
+    if (stream->block < stream->target && stream->length >= VPCLMUL_MIN)
+    {
+        /* 64-byte state is the same polynomial as 256-byte state with 192 leading zero bytes */
+        memcpy(stream->lanes + 192, stream->lanes, 64);
+        memset(stream->lanes, 0, 192);
+        stream->block = 256;
+    }
+
+    fill = length / stream->block * stream->block;
+    stream_fold(stream, input, length / stream->block);
+    memcpy(stream->pending, input + fill, length - fill);
+    stream->pending_length = (uint32_t)(length - fill);
+}
+
+CRC32C_API uint32_t crc32c_appendv(uint32_t crc, const struct iovec *iov, int count)
+{
+    crc32c_stream stream;
+    int i;
+
+    /* single segment doesn't need the stream, which would only add copying for short inputs */
+    if (count == 1)
+        return crc32c_append(crc, (buffer)iov[0].iov_base, iov[0].iov_len);
+    crc32c_stream_init(&stream, crc);
+    for (i = 0; i < count; ++i)
+        crc32c_stream_append(&stream, (buffer)iov[i].iov_base, iov[i].iov_len);
+    return crc32c_stream_value(&stream);
+}
+
+#ifdef _WIN32
+CRC32C_API int crc32c_file(const char *path, uint32_t *crc)
+{
+    HANDLE file, mapping;
+    LARGE_INTEGER size;
+    uint64_t offset = 0;
+    uint32_t result = 0;
+    int status = 0;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return -1;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return -1;
+    }
+    if (size.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping)
+        {
+            CloseHandle(file);
+            return -1;
+        }
+        while (offset < (uint64_t)size.QuadPart)
+        {
+            size_t length = (uint64_t)size.QuadPart - offset < FILE_WINDOW ? (size_t)((uint64_t)size.QuadPart - offset) : FILE_WINDOW;
+            void *view = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(offset >> 32), (DWORD)offset, length);
+            if (!view)
+            {
+                status = -1;
+                break;
+            }
+            result = crc32c_append(result, (buffer)view, length);
+            UnmapViewOfFile(view);
+            offset += length;
+        }
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if (status == 0)
+        *crc = result;
+    return status;
+}
+#else
+CRC32C_API int crc32c_file(const char *path, uint32_t *crc)
+{
+    struct stat info;
+    uint64_t offset = 0;
+    uint32_t result = 0;
+    int fd, error;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &info) != 0)
+        goto fail;
+    /* size of pipes and devices is not known in advance */
+    if (!S_ISREG(info.st_mode))
+    {
+        errno = EINVAL;
+        goto fail;
+    }
+    while (offset < (uint64_t)info.st_size)
+    {
+        size_t length = (uint64_t)info.st_size - offset < FILE_WINDOW ? (size_t)((uint64_t)info.st_size - offset) : FILE_WINDOW;
+        void *window = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, (off_t)offset);
+        if (window == MAP_FAILED)
+            goto fail;
+        madvise(window, length, MADV_SEQUENTIAL);
+        madvise(window, length, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+        /* only some filesystems back file mappings with huge pages, elsewhere it is ignored */
+        madvise(window, length, MADV_HUGEPAGE);
+#endif
+#ifdef POSIX_FADV_WILLNEED
+        /* start reading the next window while this one is being hashed */
+        if (offset + length < (uint64_t)info.st_size)
+            posix_fadvise(fd, (off_t)(offset + length), FILE_WINDOW, POSIX_FADV_WILLNEED);
+#endif
+        result = crc32c_append(result, (buffer)window, length);
+        munmap(window, length);
+        offset += length;
+    }
+    close(fd);
+    *crc = result;
+    return 0;
+
+fail:
+    error = errno;
+    close(fd);
+    errno = error;
+    return -1;
+}
+#endif
+
+#ifdef CRC32C_X64
+typedef uint64_t copy_word;
+#else
+typedef uint32_t copy_word;
+#endif
+
+/* Feed one 16-byte block to the crc instruction from the vector register it was loaded into. */
+static CRC32C_FORCEINLINE copy_word copy_crc16(copy_word crc, __m128i block)
+{
+#ifdef CRC32C_X64
+    crc = _mm_crc32_u64(crc, (uint64_t)_mm_cvtsi128_si64(block));
+    crc = _mm_crc32_u64(crc, (uint64_t)_mm_extract_epi64(block, 1));
+#else
+    crc = _mm_crc32_u32(crc, (uint32_t)_mm_cvtsi128_si32(block));
+    crc = _mm_crc32_u32(crc, (uint32_t)_mm_extract_epi32(block, 1));
+    crc = _mm_crc32_u32(crc, (uint32_t)_mm_extract_epi32(block, 2));
+    crc = _mm_crc32_u32(crc, (uint32_t)_mm_extract_epi32(block, 3));
+#endif
+    return crc;
+}
+
+/* Non-temporal copies shorter than this use regular stores, because their output takes little
+   cache, and streaming stores of a few lines to memory are up to twice slower than cached ones. */
+#define COPY_NT_MIN 65536
+
+/* Store one 16-byte block either normally or with non-temporal store that bypasses cache. */
+#define COPY_STORE(dst, block, nt) do { if (nt) _mm_stream_si128((__m128i *)(dst), block); else _mm_store_si128((__m128i *)(dst), block); } while (0)
+
+/* Copy input and compute its crc in one pass.  Every block is loaded into a vector register once,
+   and the crc instruction takes its words from the register, which is then stored.
+   Vector stores halve store count compared to word stores, which would otherwise limit speed.
+   Three streams run in parallel like in crc32c_append_hw.  Destination is aligned, because
+   non-temporal stores need it.  Inlined, so that the store kind is resolved at compile time. */
+static CRC32C_FORCEINLINE uint32_t copy_hw(uint32_t crc, uint8_t *dst, buffer src, size_t len, int nt)
+{
+    copy_word crc0, crc1, crc2;
+    __m128i block0, block1, block2;
+    uint8_t *end;
+
+    crc0 = crc ^ 0xffffffff;
+    while (len && ((uintptr_t)dst & 15) != 0)
+    {
+        crc0 = _mm_crc32_u8((uint32_t)crc0, *src);
+        *dst++ = *src++;
+        --len;
+    }
+
+    while (len >= 3 * LONG_SHIFT)
+    {
+        crc1 = 0;
+        crc2 = 0;
+        end = dst + LONG_SHIFT;
+        do
+        {
+            block0 = _mm_loadu_si128((const __m128i *)src);
+            block1 = _mm_loadu_si128((const __m128i *)(src + LONG_SHIFT));
+            block2 = _mm_loadu_si128((const __m128i *)(src + 2 * LONG_SHIFT));
+            crc0 = copy_crc16(crc0, block0);
+            crc1 = copy_crc16(crc1, block1);
+            crc2 = copy_crc16(crc2, block2);
+            COPY_STORE(dst, block0, nt);
+            COPY_STORE(dst + LONG_SHIFT, block1, nt);
+            COPY_STORE(dst + 2 * LONG_SHIFT, block2, nt);
+            src += 16;
+            dst += 16;
+        } while (dst < end);
+        crc0 = shift_crc(long_shifts.dword_table, (uint32_t)crc0) ^ crc1;
+        crc0 = shift_crc(long_shifts.dword_table, (uint32_t)crc0) ^ crc2;
+        src += 2 * LONG_SHIFT;
+        dst += 2 * LONG_SHIFT;
+        len -= 3 * LONG_SHIFT;
+    }
+
+    while (len >= 3 * SHORT_SHIFT)
+    {
+        crc1 = 0;
+        crc2 = 0;
+        end = dst + SHORT_SHIFT;
+        do
+        {
+            block0 = _mm_loadu_si128((const __m128i *)src);
+            block1 = _mm_loadu_si128((const __m128i *)(src + SHORT_SHIFT));
+            block2 = _mm_loadu_si128((const __m128i *)(src + 2 * SHORT_SHIFT));
+            crc0 = copy_crc16(crc0, block0);
+            crc1 = copy_crc16(crc1, block1);
+            crc2 = copy_crc16(crc2, block2);
+            COPY_STORE(dst, block0, nt);
+            COPY_STORE(dst + SHORT_SHIFT, block1, nt);
+            COPY_STORE(dst + 2 * SHORT_SHIFT, block2, nt);
+            src += 16;
+            dst += 16;
+        } while (dst < end);
+        crc0 = shift_crc(short_shifts.dword_table, (uint32_t)crc0) ^ crc1;
+        crc0 = shift_crc(short_shifts.dword_table, (uint32_t)crc0) ^ crc2;
+        src += 2 * SHORT_SHIFT;
+        dst += 2 * SHORT_SHIFT;
+        len -= 3 * SHORT_SHIFT;
+    }
+
+    while (len >= 16)
+    {
+        block0 = _mm_loadu_si128((const __m128i *)src);
+        crc0 = copy_crc16(crc0, block0);
+        COPY_STORE(dst, block0, nt);
+        src += 16;
+        dst += 16;
+        len -= 16;
+    }
+    while (len)
+    {
+        crc0 = _mm_crc32_u8((uint32_t)crc0, *src);
+        *dst++ = *src++;
+        --len;
+    }
+
+    /* make non-temporal stores visible to other threads like regular stores */
+    if (nt)
+        _mm_sfence();
+    return (uint32_t)crc0 ^ 0xffffffff;
+}
+
+/* Chunks small enough to stay in L1 cache between software crc and copying, so that input
+   is read from memory only once without the crc instruction too. */
+#define COPY_CHUNK 4096
+
+static uint32_t copy_sw(uint32_t crc, uint8_t *dst, buffer src, size_t len)
+{
+    size_t chunk;
+    while (len)
+    {
+        chunk = len < COPY_CHUNK ? len : COPY_CHUNK;
+        crc = crc32c_append(crc, src, chunk);
+        memcpy(dst, src, chunk);
+        src += chunk;
+        dst += chunk;
+        len -= chunk;
+    }
+    return crc;
+}
+
+CRC32C_API uint32_t crc32c_copy(uint32_t crc, uint8_t *dst, buffer src, size_t length)
+{
+    if (!selected_hw())
+        return copy_sw(crc, dst, src, length);
+    return copy_hw(crc, dst, src, length, 0);
+}
+
+CRC32C_API uint32_t crc32c_copy_nt(uint32_t crc, uint8_t *dst, buffer src, size_t length)
 {
-	return append_func(crc, input, length);
+    if (!selected_hw())
+        return copy_sw(crc, dst, src, length);
+    if (length < COPY_NT_MIN)
+        return copy_hw(crc, dst, src, length, 0);
+    return copy_hw(crc, dst, src, length, 1);
 }
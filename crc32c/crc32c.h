@@ -8,6 +8,19 @@
 #define CRC32C_MSC
 #endif
 
+#if defined(_M_X64) || defined(__x86_64__)
+#define CRC32C_X64
+#endif
+
+/* Number of bytes crc32c_append_sw processes per step: 4, 8, 12, or 16. It uses 1 KB of tables per byte. */
+#ifndef CRC32C_SW_SLICES
+#ifdef CRC32C_X64
+#define CRC32C_SW_SLICES 16
+#else
+#define CRC32C_SW_SLICES 12
+#endif
+#endif
+
 #ifndef CRC32C_STATIC
 #ifdef CRC32C_EXPORTS
 #ifdef CRC32C_GCC
@@ -29,6 +42,17 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#ifndef _WIN32
+#include <sys/uio.h>
+#elif !defined(CRC32C_NO_IOVEC)
+/* Windows has no iovec. Define CRC32C_NO_IOVEC if another library already declares it with the same members. */
+struct iovec
+{
+    void *iov_base;
+    size_t iov_len;
+};
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -50,22 +74,237 @@ CRC32C_API uint32_t crc32c_append(
 */
 CRC32C_API uint32_t crc32c_append_sw(uint32_t crc, const uint8_t *input, size_t length);
 
+/*
+    Software versions of CRC-32C (Castagnoli) checksum that slice input by 4, 8, or 16 bytes.
+    Slicing by fewer bytes is slower, but its smaller tables leave more of L1 cache to the caller.
+*/
+CRC32C_API uint32_t crc32c_append_sw4(uint32_t crc, const uint8_t *input, size_t length);
+CRC32C_API uint32_t crc32c_append_sw8(uint32_t crc, const uint8_t *input, size_t length);
+CRC32C_API uint32_t crc32c_append_sw16(uint32_t crc, const uint8_t *input, size_t length);
+
+/*
+    Software version of CRC-32C (Castagnoli) checksum that interleaves three independent streams of table lookups.
+    Faster than crc32c_append_sw on long inputs on CPUs that can keep many loads in flight.
+    It is not selected automatically, because it always uses 16 KB of slice-by-16 tables regardless of CRC32C_SW_SLICES.
+*/
+CRC32C_API uint32_t crc32c_append_braided(uint32_t crc, const uint8_t *input, size_t length);
+
 /*
 	Hardware version of CRC-32C (Castagnoli) checksum. Will fail, if CPU does not support related instructions. Use a crc32c_append version instead of.
 */
 CRC32C_API uint32_t crc32c_append_hw(uint32_t crc, const uint8_t *input, size_t length);
 
+/*
+	Hardware version of CRC-32C (Castagnoli) checksum that folds large inputs with carry-less multiplication (PCLMULQDQ).
+	Will fail, if CPU does not support related instructions. Use a crc32c_append version instead of.
+*/
+CRC32C_API uint32_t crc32c_append_clmul(uint32_t crc, const uint8_t *input, size_t length);
+
+/*
+	Hardware version of CRC-32C (Castagnoli) checksum that folds large inputs with AVX-512 carry-less multiplication (VPCLMULQDQ).
+	Inputs shorter than a few KB are processed by crc32c_append_clmul to avoid AVX-512 frequency penalty.
+	Will fail, if CPU does not support related instructions. Use a crc32c_append version instead of.
+*/
+CRC32C_API uint32_t crc32c_append_vpclmul(uint32_t crc, const uint8_t *input, size_t length);
+
+/*
+	Hardware version of CRC-32C (Castagnoli) checksum that runs crc instruction and carry-less multiplication (PCLMULQDQ) in parallel.
+	Available whenever crc32c_append_clmul is available. Will fail, if CPU does not support related instructions. Use a crc32c_append version instead of.
+*/
+CRC32C_API uint32_t crc32c_append_hybrid(uint32_t crc, const uint8_t *input, size_t length);
+
+/*
+    Same as crc32c_append, but picks the kernel by input size according to table measured by crc32c_calibrate.
+    First call runs calibration if crc32c_calibrate wasn't called, caching results in file named by CRC32C_CALIBRATION environment variable.
+*/
+CRC32C_API uint32_t crc32c_append_calibrated(uint32_t crc, const uint8_t *input, size_t length);
+
+/*
+    Measures available kernels on inputs of various sizes and picks the fastest one for tiny, medium, and large inputs.
+    Takes tens of milliseconds. Results are loaded from the cache file when it was written on the same CPU model.
+    Returns nonzero if results were loaded from the cache.
+*/
+CRC32C_API int crc32c_calibrate(
+    const char *cache);         /* Cache file, created if missing, or NULL to disable caching.     */
+
+/*
+    Computes CRC-32C of many independent messages at once. Interleaving the messages makes it much faster
+    than calling crc32c_append for every message when the messages are short.
+*/
+CRC32C_API void crc32c_append_batch(
+    const uint8_t **inputs,     /* Messages to be put through the CRC algorithm.                   */
+    const size_t *lengths,      /* Lengths of the messages.                                        */
+    uint32_t *crcs,             /* Initial CRC values on input, CRCs of the messages on output.    */
+    size_t count);              /* Number of messages.                                             */
+
+/*
+    Same as crc32c_append on buffer filled with zeros, but the buffer is not needed and cost is logarithmic in length.
+*/
+CRC32C_API uint32_t crc32c_append_zeros(
+    uint32_t crc,               /* Initial CRC value.                                              */
+    size_t length);             /* Number of zero bytes to append.                                 */
+
+/*
+    Combines CRC-32C of two consecutive buffers into CRC-32C of their concatenation without reading the data again.
+    Cost is logarithmic in length2.
+*/
+CRC32C_API uint32_t crc32c_combine(
+    uint32_t crc1,              /* CRC of the first buffer.                                        */
+    uint32_t crc2,              /* CRC of the second buffer computed with zero initial value.      */
+    size_t length2);            /* Length of the second buffer.                                    */
+
+/*
+    Precomputes operator for crc32c_combine_op. Use it when many CRCs are combined with the same length2.
+*/
+CRC32C_API uint32_t crc32c_combine_gen(size_t length2);
+
+/*
+    Same as crc32c_combine, but length2 is supplied as operator precomputed by crc32c_combine_gen. Runs in constant time.
+*/
+CRC32C_API uint32_t crc32c_combine_op(uint32_t crc1, uint32_t crc2, uint32_t op);
+
+/*
+    Updates CRC-32C of a buffer after some of its bytes were overwritten without reading the rest of the buffer.
+    Cost is linear in count and logarithmic in length. Patched region must lie within the buffer.
+*/
+CRC32C_API uint32_t crc32c_update(
+    uint32_t crc,               /* CRC of the buffer before the change.                            */
+    size_t length,              /* Length of the whole buffer.                                     */
+    size_t offset,              /* Position of the patched region in the buffer.                   */
+    const uint8_t *old_bytes,   /* Content of the patched region before the change.                */
+    const uint8_t *new_bytes,   /* Content of the patched region after the change.                 */
+    size_t count);              /* Length of the patched region.                                   */
+
+/*
+    Task run by crc32c_executor. Index identifies part of the work.
+*/
+typedef void (*crc32c_task)(void *context, size_t index);
+
+/*
+    Runs task for every index from 0 to count - 1, possibly in parallel, and returns after all of them complete.
+*/
+typedef void (*crc32c_executor)(void *executor_context, crc32c_task task, void *context, size_t count);
+
+/*
+    Same as crc32c_append, but splits large input among several threads and merges partial CRCs.
+    Inputs shorter than a few MB per thread are processed on the calling thread.
+*/
+CRC32C_API uint32_t crc32c_append_parallel(
+    uint32_t crc,               /* Initial CRC value.                                              */
+    const uint8_t *input,       /* Data to be put through the CRC algorithm.                       */
+    size_t length,              /* Length of the data in the input buffer.                         */
+    int threads);               /* Maximum number of threads. Zero or less means all processors.   */
+
+/*
+    Same as crc32c_append_parallel, but tasks are run by caller-supplied executor, typically a thread pool.
+*/
+CRC32C_API uint32_t crc32c_append_parallel_with(
+    uint32_t crc,               /* Initial CRC value.                                              */
+    const uint8_t *input,       /* Data to be put through the CRC algorithm.                       */
+    size_t length,              /* Length of the data in the input buffer.                         */
+    size_t tasks,               /* Maximum number of tasks to split the input into.                */
+    crc32c_executor executor,   /* Executor that runs the tasks.                                   */
+    void *executor_context);    /* Context passed to the executor.                                 */
+
+/*
+    State of CRC-32C computed over data supplied in pieces. Carry-less multiplication accumulators
+    are kept between appends, so pieces of 1KB are processed at close to the speed of one contiguous
+    buffer even with the crc instruction kernel. Software kernels are simply called on every piece.
+    Members are private. Initialize it with crc32c_stream_init.
+*/
+typedef struct crc32c_stream
+{
+    uint8_t lanes[256];
+    uint8_t pending[256];
+    uint64_t length;
+    uint32_t crc;
+    uint32_t pending_length;
+    int block;
+    int target;
+} crc32c_stream;
+
+/*
+    Starts new stream with initial CRC value, typically 0.
+*/
+CRC32C_API void crc32c_stream_init(crc32c_stream *stream, uint32_t crc);
+
+/*
+    Appends data to the stream. Same as crc32c_append on the concatenation of everything appended so far.
+*/
+CRC32C_API void crc32c_stream_append(
+    crc32c_stream *stream,      /* Stream initialized with crc32c_stream_init.                     */
+    const uint8_t *input,       /* Data to be put through the CRC algorithm.                       */
+    size_t length);             /* Length of the data in the input buffer.                         */
+
+/*
+    Returns CRC of all data appended so far. The stream is not modified and more data can be appended.
+*/
+CRC32C_API uint32_t crc32c_stream_value(const crc32c_stream *stream);
+
+/*
+    Computes CRC-32C of data scattered across several buffers. Same as crc32c_append on their concatenation,
+    but it keeps carry-less multiplication lanes running across buffer boundaries like crc32c_stream_append does,
+    so many buffers of 1KB are hashed at close to the speed of one long one with any hardware kernel.
+*/
+CRC32C_API uint32_t crc32c_appendv(
+    uint32_t crc,               /* Initial CRC value. Typically it's 0.                            */
+    const struct iovec *iov,    /* Buffers in the order they are put through the CRC algorithm.    */
+    int count);                 /* Number of buffers.                                              */
+
+/*
+    Copies input to output and returns CRC-32C of the copied data. About as fast as memcpy followed by crc32c_append
+    when input is in cache, and faster when it isn't, because input is read from memory only once. Buffers must not overlap.
+*/
+CRC32C_API uint32_t crc32c_copy(
+    uint32_t crc,               /* Initial CRC value.                                              */
+    uint8_t *output,            /* Destination buffer with room for length bytes.                  */
+    const uint8_t *input,       /* Data to be copied and put through the CRC algorithm.            */
+    size_t length);             /* Length of the data in the input buffer.                         */
+
+/*
+    Same as crc32c_copy, but output of copies of 64KB and more is written with non-temporal stores that bypass cache
+    when the crc instruction is used.
+    Use it for large copies whose output won't be read soon, so that they don't evict useful data from cache.
+*/
+CRC32C_API uint32_t crc32c_copy_nt(uint32_t crc, uint8_t *output, const uint8_t *input, size_t length);
+
+/*
+    Computes CRC-32C of a whole file. The file is memory-mapped in windows of 64MB, so there's no copying
+    through userspace buffer and memory use stays bounded even for files larger than RAM.
+    Returns 0 on success or -1 on error, which is then described by errno (GetLastError on Windows).
+    Only regular files are supported. Other processes must not truncate the file while it is being read.
+*/
+CRC32C_API int crc32c_file(
+    const char *path,           /* Path of the file.                                               */
+    uint32_t *crc);             /* Receives CRC of the file computed with zero initial value.      */
+
 /*
 	Checks is hardware version of CRC-32C is available.
 */
 CRC32C_API int crc32c_hw_available();
 
-#ifndef __cplusplus
 /*
-    Initializes the CRC-32C library. Should be called only by C users to enable hardware version for crc32c_append.
+	Checks is carry-less multiplication version of CRC-32C is available.
+*/
+CRC32C_API int crc32c_clmul_available();
+
+/*
+	Checks is AVX-512 carry-less multiplication version of CRC-32C is available.
+*/
+CRC32C_API int crc32c_vpclmul_available();
+
+/*
+    Describes code paths the library was compiled with, e.g. "x86-64 (crc32q, slice-by-16)".
+*/
+CRC32C_API const char *crc32c_build_isa();
+
+/*
+    Selects the fastest implementation for crc32c_append right away instead of on first use. Calling it is optional.
+    Environment variable CRC32C_KERNEL can pin the implementation to one of sw, sw4, sw8, sw16, braided,
+    hw, hybrid, clmul, or vpclmul, which is useful when chasing performance regressions, or to calibrated
+    to use crc32c_append_calibrated. Pinned implementation is ignored if the CPU doesn't support it.
 */
 CRC32C_API void crc32c_init();
-#endif
 
 
 #ifdef __cplusplus
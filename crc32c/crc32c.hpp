@@ -0,0 +1,242 @@
+/* Part of CRC-32C library: https://crc32c.machinezoo.com/ */
+#ifndef CRC32C_HPP
+#define CRC32C_HPP
+
+#include "crc32c.h"
+#include <string.h>
+
+/*
+    Header-only C++ layer over CRC-32C library. Fixed-length variants are inlined into the caller
+    as a straight sequence of crc instructions when the translation unit targets SSE4.2
+    (e.g. -msse4.2 or -march=native with GCC, /arch:AVX or higher with MSVC).
+    Otherwise they fall back to crc32c_append.
+*/
+
+#if defined(__SSE4_2__) || defined(__AVX__)
+#define CRC32C_INLINE_HW
+#include <nmmintrin.h>
+#endif
+
+/* Definitions that depend on the instruction set live in an inline namespace named after it, so that
+   translation units built with and without SSE4.2 don't share (and the linker doesn't merge) them. */
+#ifdef CRC32C_INLINE_HW
+#define CRC32C_ISA_NAMESPACE sse42
+#else
+#define CRC32C_ISA_NAMESPACE portable
+#endif
+
+#ifndef CRC32C_FORCEINLINE
+#ifdef CRC32C_GCC
+#define CRC32C_FORCEINLINE inline __attribute__((always_inline))
+#else
+#define CRC32C_FORCEINLINE __forceinline
+#endif
+#endif
+
+/* Fixed lengths above this are passed to the library, which runs several crc streams in parallel. */
+#ifndef CRC32C_INLINE_MAX
+#define CRC32C_INLINE_MAX 512
+#endif
+
+namespace crc32c
+{
+    namespace detail
+    {
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+#define CRC32C_CONSTEXPR
+
+        struct constexpr_table
+        {
+            uint32_t entries[256];
+        };
+
+        /* Same table as dword_table[0] in crc32c.c, generated at compile time from the reflected polynomial. */
+        constexpr constexpr_table make_table()
+        {
+            constexpr_table table = {};
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t crc = n;
+                for (int k = 0; k < 8; ++k)
+                    crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+                table.entries[n] = crc;
+            }
+            return table;
+        }
+
+        template<typename T = void>
+        struct constexpr_tables
+        {
+            static constexpr constexpr_table table = make_table();
+        };
+
+        template<typename T>
+        constexpr constexpr_table constexpr_tables<T>::table;
+#endif
+
+        inline namespace CRC32C_ISA_NAMESPACE
+        {
+#ifdef CRC32C_INLINE_HW
+#ifdef CRC32C_X64
+            typedef uint64_t word;
+#else
+            typedef uint32_t word;
+#endif
+
+            /* Straight-line crc of N bytes. Long sequences are split in halves to keep template recursion shallow. */
+            template<size_t N, int Kind = (N >= 16 ? 2 : N >= 8 ? 1 : 0)>
+            struct unrolled;
+
+            template<size_t N>
+            struct unrolled<N, 2>
+            {
+                static CRC32C_FORCEINLINE word append(word crc, const uint8_t *input)
+                {
+                    return unrolled<N - N / 16 * 8>::append(unrolled<N / 16 * 8>::append(crc, input), input + N / 16 * 8);
+                }
+            };
+
+            template<size_t N>
+            struct unrolled<N, 1>
+            {
+                static CRC32C_FORCEINLINE word append(word crc, const uint8_t *input)
+                {
+#ifdef CRC32C_X64
+                    uint64_t value;
+                    memcpy(&value, input, 8);
+                    crc = _mm_crc32_u64(crc, value);
+#else
+                    uint32_t low, high;
+                    memcpy(&low, input, 4);
+                    memcpy(&high, input + 4, 4);
+                    crc = _mm_crc32_u32(_mm_crc32_u32(crc, low), high);
+#endif
+                    return unrolled<N - 8>::append(crc, input + 8);
+                }
+            };
+
+            template<size_t N>
+            struct unrolled<N, 0>
+            {
+                static CRC32C_FORCEINLINE word append(word crc, const uint8_t *input)
+                {
+                    uint32_t result = (uint32_t)crc;
+                    if (N & 4)
+                    {
+                        uint32_t value;
+                        memcpy(&value, input, 4);
+                        result = _mm_crc32_u32(result, value);
+                        input += 4;
+                    }
+                    if (N & 2)
+                    {
+                        uint16_t value;
+                        memcpy(&value, input, 2);
+                        result = _mm_crc32_u16(result, value);
+                        input += 2;
+                    }
+                    if (N & 1)
+                        result = _mm_crc32_u8(result, *input);
+                    return result;
+                }
+            };
+#endif
+
+            template<size_t N, bool Inline>
+            struct fixed
+            {
+                static inline uint32_t append(uint32_t crc, const uint8_t *input)
+                {
+                    return crc32c_append(crc, input, N);
+                }
+            };
+
+#ifdef CRC32C_INLINE_HW
+            template<size_t N>
+            struct fixed<N, true>
+            {
+                static CRC32C_FORCEINLINE uint32_t append(uint32_t crc, const uint8_t *input)
+                {
+                    return (uint32_t)unrolled<N>::append(crc ^ 0xffffffff, input) ^ 0xffffffff;
+                }
+            };
+#endif
+        }
+    }
+
+    inline namespace CRC32C_ISA_NAMESPACE
+    {
+        /*
+            Computes CRC-32C of input of fixed length N. Same as crc32c_append(crc, input, N), but inlined.
+        */
+        template<size_t N>
+        inline uint32_t append(uint32_t crc, const uint8_t *input)
+        {
+#ifdef CRC32C_INLINE_HW
+            return detail::fixed<N, N <= CRC32C_INLINE_MAX>::append(crc, input);
+#else
+            return detail::fixed<N, false>::append(crc, input);
+#endif
+        }
+    }
+
+    /*
+        Computes CRC-32C of input of variable length. Same as crc32c_append.
+    */
+    inline uint32_t append(uint32_t crc, const uint8_t *input, size_t length)
+    {
+        return crc32c_append(crc, input, length);
+    }
+
+    /*
+        Computes CRC-32C of data supplied in pieces. Same as chained append calls, but much faster when the pieces are short.
+    */
+    class stream
+    {
+    public:
+        explicit stream(uint32_t crc = 0)
+        {
+            crc32c_stream_init(&state, crc);
+        }
+
+        stream &append(const uint8_t *input, size_t length)
+        {
+            crc32c_stream_append(&state, input, length);
+            return *this;
+        }
+
+        uint32_t value() const
+        {
+            return crc32c_stream_value(&state);
+        }
+
+    private:
+        crc32c_stream state;
+    };
+
+#ifdef CRC32C_CONSTEXPR
+    /*
+        Computes CRC-32C at compile time. Same as crc32c_append when evaluated at runtime, but much slower.
+        Requires C++14.
+    */
+    template<typename T>
+    constexpr uint32_t append_constexpr(uint32_t crc, const T *input, size_t length)
+    {
+        crc ^= 0xffffffff;
+        for (size_t i = 0; i < length; ++i)
+            crc = detail::constexpr_tables<>::table.entries[(crc ^ static_cast<uint8_t>(input[i])) & 0xff] ^ (crc >> 8);
+        return crc ^ 0xffffffff;
+    }
+
+    /*
+        Computes CRC-32C of string literal at compile time. Terminating null character is not included.
+    */
+    template<size_t N>
+    constexpr uint32_t literal(const char (&text)[N])
+    {
+        return append_constexpr(0, text, N - 1);
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,59 @@
+// inline.cpp : Tests of fixed-length inline append. Compiled for SSE4.2, so that crc32c.hpp expands it into crc instructions.
+//
+
+#include "stdafx.h"
+#include <stdlib.h>
+#include <chrono>
+
+#include "crc32c.h"
+#include "crc32c.hpp"
+
+#define LATENCY_CALLS 20000
+
+typedef const uint8_t *buffer;
+
+template<size_t N>
+static void check_fixed(buffer input)
+{
+    for (int offset = 0; offset < 64; ++offset)
+    {
+        uint32_t expected = crc32c_append_sw(offset, input + offset, N);
+        uint32_t actual = crc32c::append<N>(offset, input + offset);
+        if (expected != actual)
+        {
+            printf("CRC mismatch between table and inline append<%d> at offset %d: %x vs %x\n", (int)N, offset, expected, actual);
+            exit(1);
+        }
+    }
+}
+
+template<size_t N>
+static void benchmark_fixed(buffer input)
+{
+    uint32_t crc = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LATENCY_CALLS; ++i)
+        crc = crc32c::append<N>(crc, input + (crc & 63));
+    std::chrono::duration<double, std::nano> inlined = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LATENCY_CALLS; ++i)
+        crc = crc32c_append(crc, input + (crc & 63), N);
+    std::chrono::duration<double, std::nano> library = std::chrono::steady_clock::now() - start;
+    printf("append<%d>: %.1f ns inline, %.1f ns library\n", (int)N, inlined.count() / LATENCY_CALLS, library.count() / LATENCY_CALLS);
+}
+
+void check_inline(buffer input)
+{
+    check_fixed<0>(input);
+    check_fixed<1>(input);
+    check_fixed<7>(input);
+    check_fixed<13>(input);
+    check_fixed<16>(input);
+    check_fixed<32>(input);
+    check_fixed<255>(input);
+    check_fixed<512>(input);
+    check_fixed<4096>(input);
+    benchmark_fixed<16>(input);
+    benchmark_fixed<32>(input);
+    benchmark_fixed<4096>(input);
+}
@@ -4,6 +4,9 @@
 #include "stdafx.h"
 #include <random>
 #include <algorithm>
+#include <thread>
+#include <chrono>
+#include <vector>
 #define NOMINMAX
 #if defined(_MSC_VER)
 #include <windows.h>
@@ -12,6 +15,7 @@
 #endif
 
 #include "crc32c.h"
+#include "crc32c.hpp"
 
 #define TEST_BUFFER 65536
 #define TEST_SLICES 1000000
@@ -126,6 +130,27 @@ static int benchmark(const char *name, uint32_t(*function)(uint32_t, buffer, siz
     return std::min(TEST_SLICES, iterations);
 }
 
+#define LATENCY_MAX 256
+#define LATENCY_CALLS 20000
+
+/* Measures ns per call of dependent calls, i.e. latency, for every length up to LATENCY_MAX. */
+static void benchmark_latency(const char *name, uint32_t(*function)(uint32_t, buffer, size_t), buffer input)
+{
+    printf("%s latency (ns/call):", name);
+    uint32_t crc = 0;
+    for (int length = 0; length <= LATENCY_MAX; ++length)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < LATENCY_CALLS; ++i)
+            crc = function(crc, input + (crc & 63), length);
+        std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+        if (length % 16 == 0)
+            printf("\n%5d:", length);
+        printf(" %5.1f", time.count() / LATENCY_CALLS);
+    }
+    printf("\n");
+}
+
 static void compare_crcs(const char *leftName, uint32_t *left, const char *rightName, uint32_t *right, int count)
 {
     for (int i = 0; i < count; ++i)
@@ -136,6 +161,554 @@ static void compare_crcs(const char *leftName, uint32_t *left, const char *right
         }
 }
 
+static void check_combine(buffer input, int *offsets, int *lengths)
+{
+    for (int i = 0; i < TEST_SLICES / 10; ++i)
+    {
+        int split = i % (lengths[i] + 1);
+        uint32_t whole = crc32c_append(0, input + offsets[i], lengths[i]);
+        uint32_t first = crc32c_append(0, input + offsets[i], split);
+        uint32_t second = crc32c_append(0, input + offsets[i] + split, lengths[i] - split);
+        uint32_t combined = crc32c_combine(first, second, lengths[i] - split);
+        if (combined != whole)
+        {
+            printf("CRC mismatch between append and combine at offset %d: %x vs %x\n", i, whole, combined);
+            exit(1);
+        }
+    }
+    /* zero is not a valid operator, but it must not hang */
+    if (crc32c_combine_op(0x12345678, 0x9abcdef0, 0) != 0x9abcdef0)
+    {
+        printf("crc32c_combine_op with zero operator returned wrong result\n");
+        exit(1);
+    }
+}
+
+static void benchmark_combine(int *lengths)
+{
+    uint64_t startTime = GetTicks();
+    uint32_t crc = 0;
+    uint64_t calls = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        for (int i = 0; i < 1000; ++i)
+            crc = crc32c_combine(crc, crc, lengths[i]);
+        calls += 1000;
+    }
+    printf("combine: %.0f ns\n", (GetTicks() - startTime) * 1000000.0 / calls);
+    uint32_t op = crc32c_combine_gen(4 * 1024 * 1024);
+    startTime = GetTicks();
+    calls = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        for (int i = 0; i < 1000; ++i)
+            crc = crc32c_combine_op(crc, crc, op);
+        calls += 1000;
+    }
+    printf("combine_op: %.0f ns\n", (GetTicks() - startTime) * 1000000.0 / calls);
+}
+
+static void check_update(buffer input, int *offsets, int *lengths)
+{
+    uint8_t *patched = new uint8_t[TEST_BUFFER];
+    std::mt19937 random(1);
+    for (int i = 0; i < TEST_SLICES / 100; ++i)
+    {
+        int length = lengths[i];
+        int offset = std::uniform_int_distribution<int>(0, length)(random);
+        int count = std::uniform_int_distribution<int>(0, std::min(length - offset, 1 << (i % 12)))(random);
+        memcpy(patched, input + offsets[i], length);
+        for (int k = 0; k < count; ++k)
+            patched[offset + k] = (uint8_t)random();
+        uint32_t before = crc32c_append(i, input + offsets[i], length);
+        uint32_t expected = crc32c_append(i, patched, length);
+        uint32_t actual = crc32c_update(before, length, offset, input + offsets[i] + offset, patched + offset, count);
+        if (actual != expected)
+        {
+            printf("CRC mismatch between append and update at offset %d: %x vs %x\n", i, expected, actual);
+            exit(1);
+        }
+    }
+    delete[] patched;
+}
+
+/* Patches 8-byte field at the start of 1MB block, which is the worst case for the shift. */
+static void benchmark_update(buffer input)
+{
+    uint64_t startTime = GetTicks();
+    uint32_t crc = 0;
+    uint64_t calls = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        for (int i = 0; i < 1000; ++i)
+            crc = crc32c_update(crc, 1024 * 1024, 0, input + i, input + i + 8, 8);
+        calls += 1000;
+    }
+    printf("update 8B in 1MB: %.0f ns\n", (GetTicks() - startTime) * 1000000.0 / calls);
+}
+
+static void check_zeros(int *lengths)
+{
+    uint8_t *zeros = new uint8_t[TEST_BUFFER]();
+    for (int i = 0; i < TEST_SLICES / 100; ++i)
+    {
+        uint32_t crc = (uint32_t)lengths[i + 1] * 0x9e3779b9;
+        uint32_t expected = crc32c_append(crc, zeros, lengths[i]);
+        uint32_t actual = crc32c_append_zeros(crc, lengths[i]);
+        if (expected != actual)
+        {
+            printf("CRC mismatch between append and append_zeros at offset %d: %x vs %x\n", i, expected, actual);
+            exit(1);
+        }
+    }
+    delete[] zeros;
+}
+
+static void benchmark_zeros()
+{
+    static const uint64_t sizes[] = { 4096, 1024 * 1024, 1024 * 1024 * 1024, 1024ull * 1024 * 1024 * 1024 };
+    static const char *names[] = { "4KB", "1MB", "1GB", "1TB" };
+    for (int s = 0; s < 4; ++s)
+    {
+        if (sizes[s] > SIZE_MAX)
+            continue;
+        size_t length = (size_t)sizes[s];
+        uint64_t startTime = GetTicks();
+        uint32_t crc = 0;
+        uint64_t calls = 0;
+        while (GetTicks() - startTime < 250)
+        {
+            for (int i = 0; i < 1000; ++i)
+                crc = crc32c_append_zeros(crc, length);
+            calls += 1000;
+        }
+        printf("zeros %s: %.0f ns\n", names[s], (GetTicks() - startTime) * 1000000.0 / calls);
+    }
+}
+
+#define BATCH_SIZE 1024
+
+static void benchmark_batch(buffer input)
+{
+    std::random_device rd;
+    std::uniform_int_distribution<int> lengthDist(64, 512);
+    buffer inputs[BATCH_SIZE];
+    size_t lengths[BATCH_SIZE];
+    uint32_t crcs[BATCH_SIZE];
+    uint32_t expected[BATCH_SIZE];
+    uint64_t batchBytes = 0;
+    for (int i = 0; i < BATCH_SIZE; ++i)
+    {
+        lengths[i] = lengthDist(rd);
+        std::uniform_int_distribution<int> offsetDist(0, TEST_BUFFER - (int)lengths[i]);
+        inputs[i] = input + offsetDist(rd);
+        batchBytes += lengths[i];
+    }
+    uint64_t startTime = GetTicks();
+    uint64_t totalBytes = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            expected[i] = crc32c_append(i, inputs[i], lengths[i]);
+        totalBytes += batchBytes;
+    }
+    printf("batch loop: %.0f MB/s\n", totalBytes * 1000.0 / (GetTicks() - startTime) / 1024 / 1024);
+    startTime = GetTicks();
+    totalBytes = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            crcs[i] = i;
+        crc32c_append_batch(inputs, lengths, crcs, BATCH_SIZE);
+        totalBytes += batchBytes;
+    }
+    printf("batch: %.0f MB/s\n", totalBytes * 1000.0 / (GetTicks() - startTime) / 1024 / 1024);
+    compare_crcs("loop", expected, "batch", crcs, BATCH_SIZE);
+}
+
+/* Defined in inline.cpp, which is compiled for SSE4.2, so it must run only when the crc instruction is available. */
+void check_inline(buffer input);
+
+static_assert(crc32c::literal("") == 0, "CRC of empty string");
+static_assert(crc32c::literal("123456789") == 0xe3069283, "CRC-32C check value");
+static_assert(crc32c::append_constexpr(crc32c::literal("1234"), "56789", 5) == 0xe3069283, "chained CRC");
+
+static void check_constexpr(buffer input, int *offsets, int *lengths)
+{
+    for (int i = 0; i < TEST_SLICES / 1000; ++i)
+    {
+        uint32_t expected = crc32c_append_sw(i, input + offsets[i], lengths[i]);
+        uint32_t actual = crc32c::append_constexpr(i, input + offsets[i], lengths[i]);
+        if (expected != actual)
+        {
+            printf("CRC mismatch between table and constexpr at offset %d: %x vs %x\n", i, expected, actual);
+            exit(1);
+        }
+    }
+}
+
+static void check_sliced(buffer input, int *offsets, int *lengths)
+{
+    static const char *names[] = { "sw4", "sw8", "sw16" };
+    uint32_t(*functions[])(uint32_t, buffer, size_t) = { crc32c_append_sw4, crc32c_append_sw8, crc32c_append_sw16 };
+    for (int f = 0; f < 3; ++f)
+        for (int i = 0; i < TEST_SLICES / 1000; ++i)
+        {
+            uint32_t expected = crc32c_append_sw(i, input + offsets[i], lengths[i]);
+            uint32_t actual = functions[f](i, input + offsets[i], lengths[i]);
+            if (expected != actual)
+            {
+                printf("CRC mismatch between table and %s at offset %d: %x vs %x\n", names[f], i, expected, actual);
+                exit(1);
+            }
+        }
+}
+
+#define FOOTPRINT_WORKSET (24 * 1024 / 4)
+#define FOOTPRINT_CHUNK 256
+#define FOOTPRINT_READS 64
+
+static volatile uint32_t footprint_sink;
+
+/* Interleaves checksums of short chunks with dependent random reads from L1-resident working set,
+   like when checksums are computed in between other work. Larger tables evict more of the working set. */
+static void benchmark_footprint(const char *name, uint32_t(*function)(uint32_t, buffer, size_t), buffer input)
+{
+    static uint32_t workset[FOOTPRINT_WORKSET];
+    std::mt19937 random(1);
+    for (int i = 0; i < FOOTPRINT_WORKSET; ++i)
+        workset[i] = i;
+    /* single random cycle through the whole working set (Sattolo's algorithm) */
+    for (int i = FOOTPRINT_WORKSET - 1; i > 0; --i)
+        std::swap(workset[i], workset[std::uniform_int_distribution<int>(0, i - 1)(random)]);
+    uint32_t crc = 0, index = 0;
+    uint64_t rounds = 0;
+    std::chrono::duration<double, std::nano> time;
+    auto start = std::chrono::steady_clock::now();
+    do
+    {
+        for (int r = 0; r < 1000; ++r)
+        {
+            if (function)
+                crc = function(crc, input + (rounds + r) * FOOTPRINT_CHUNK % TEST_BUFFER, FOOTPRINT_CHUNK);
+            for (int i = 0; i < FOOTPRINT_READS; ++i)
+                index = workset[index];
+        }
+        rounds += 1000;
+        time = std::chrono::steady_clock::now() - start;
+    } while (time.count() < 250e6);
+    footprint_sink = crc ^ index;
+    printf("%s with L1 workload: %.1f ns/round\n", name, time.count() / rounds);
+}
+
+static void check_stream(buffer input, int *offsets, int *lengths)
+{
+    std::mt19937 random(1);
+    for (int i = 0; i < TEST_SLICES / 1000; ++i)
+    {
+        uint32_t expected = crc32c_append_sw(i, input + offsets[i], lengths[i]);
+        /* vary piece sizes from single bytes to more than the bypass threshold */
+        int maxPiece = 1 << (i % 14);
+        crc32c::stream stream(i);
+        for (int done = 0; done < lengths[i]; )
+        {
+            int piece = std::min(lengths[i] - done, std::uniform_int_distribution<int>(0, maxPiece)(random));
+            stream.append(input + offsets[i] + done, piece);
+            done += piece;
+        }
+        if (stream.value() != expected)
+        {
+            printf("CRC mismatch between table and stream at offset %d: %x vs %x\n", i, expected, stream.value());
+            exit(1);
+        }
+    }
+}
+
+/* Feeds whole test buffer in pieces of 1-4KB, as parsers do, and compares it with one contiguous call. */
+static void benchmark_stream(buffer input)
+{
+    std::mt19937 random(1);
+    std::vector<int> pieces;
+    for (int done = 0; done < TEST_BUFFER; )
+    {
+        int piece = std::min(TEST_BUFFER - done, std::uniform_int_distribution<int>(1024, 4096)(random));
+        pieces.push_back(piece);
+        done += piece;
+    }
+    uint32_t crc = 0;
+    uint64_t startTime = GetTicks();
+    uint64_t totalBytes = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        for (int i = 0; i < 16; ++i)
+            crc = crc32c_append(crc, input, TEST_BUFFER);
+        totalBytes += 16 * TEST_BUFFER;
+    }
+    printf("contiguous: %.1f GB/s\n", totalBytes * 1000.0 / (GetTicks() - startTime) / 1024 / 1024 / 1024);
+    startTime = GetTicks();
+    totalBytes = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            buffer next = input;
+            for (int piece : pieces)
+            {
+                crc = crc32c_append(crc, next, piece);
+                next += piece;
+            }
+        }
+        totalBytes += 16 * TEST_BUFFER;
+    }
+    printf("pieces append: %.1f GB/s\n", totalBytes * 1000.0 / (GetTicks() - startTime) / 1024 / 1024 / 1024);
+    startTime = GetTicks();
+    totalBytes = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            crc32c::stream stream(crc);
+            buffer next = input;
+            for (int piece : pieces)
+            {
+                stream.append(next, piece);
+                next += piece;
+            }
+            crc = stream.value();
+        }
+        totalBytes += 16 * TEST_BUFFER;
+    }
+    printf("pieces stream: %.1f GB/s\n", totalBytes * 1000.0 / (GetTicks() - startTime) / 1024 / 1024 / 1024);
+}
+
+static void check_appendv(buffer input, int *offsets, int *lengths)
+{
+    std::mt19937 random(1);
+    std::vector<struct iovec> segments;
+    for (int i = 0; i < TEST_SLICES / 1000; ++i)
+    {
+        uint32_t expected = crc32c_append_sw(i, input + offsets[i], lengths[i]);
+        int maxPiece = 1 << (i % 14);
+        segments.clear();
+        for (int done = 0; done < lengths[i]; )
+        {
+            int piece = std::min(lengths[i] - done, std::uniform_int_distribution<int>(0, maxPiece)(random));
+            struct iovec segment = { (void *)(input + offsets[i] + done), (size_t)piece };
+            segments.push_back(segment);
+            done += piece;
+        }
+        uint32_t actual = crc32c_appendv(i, segments.data(), (int)segments.size());
+        if (actual != expected)
+        {
+            printf("CRC mismatch between table and appendv at offset %d: %x vs %x\n", i, expected, actual);
+            exit(1);
+        }
+    }
+}
+
+/* Whole test buffer split into 1KB segments, once appended segment by segment and once with a single appendv call.
+   appendv keeps carry-less multiplication lanes across segments with every hardware kernel, so run this with
+   CRC32C_KERNEL=hw too to see the gain on CPUs without VPCLMULQDQ, about 1.4x at 1KB segments. */
+static void benchmark_appendv(buffer input)
+{
+    std::vector<struct iovec> segments;
+    for (int done = 0; done < TEST_BUFFER; done += 1024)
+    {
+        struct iovec segment = { (void *)(input + done), 1024 };
+        segments.push_back(segment);
+    }
+    uint32_t crc = 0;
+    uint64_t startTime = GetTicks();
+    uint64_t totalBytes = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            for (auto &segment : segments)
+                crc = crc32c_append(crc, (buffer)segment.iov_base, segment.iov_len);
+        }
+        totalBytes += 16 * TEST_BUFFER;
+    }
+    double append = totalBytes * 1000.0 / (GetTicks() - startTime) / 1024 / 1024 / 1024;
+    printf("segments append: %.1f GB/s\n", append);
+    startTime = GetTicks();
+    totalBytes = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        for (int i = 0; i < 16; ++i)
+            crc = crc32c_appendv(crc, segments.data(), (int)segments.size());
+        totalBytes += 16 * TEST_BUFFER;
+    }
+    double appendv = totalBytes * 1000.0 / (GetTicks() - startTime) / 1024 / 1024 / 1024;
+    printf("segments appendv: %.1f GB/s (%.1fx)\n", appendv, appendv / append);
+}
+
+#define CALIBRATION_CACHE "crc32c-calibration.tmp"
+
+static void check_calibration()
+{
+    remove(CALIBRATION_CACHE);
+    auto start = std::chrono::steady_clock::now();
+    int cached = crc32c_calibrate(CALIBRATION_CACHE);
+    std::chrono::duration<double, std::milli> measured = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    int reloaded = crc32c_calibrate(CALIBRATION_CACHE);
+    std::chrono::duration<double, std::milli> loaded = std::chrono::steady_clock::now() - start;
+    remove(CALIBRATION_CACHE);
+    if (cached || !reloaded)
+    {
+        printf("Calibration cache was not used correctly\n");
+        exit(1);
+    }
+    printf("calibration: %.0f ms measured, %.2f ms cached\n", measured.count(), loaded.count());
+}
+
+#define PARALLEL_BUFFER (64 * 1024 * 1024)
+
+static void check_parallel(buffer input)
+{
+    uint32_t expected = crc32c_append(1, input, PARALLEL_BUFFER);
+    for (int threads = 1; threads <= 8; ++threads)
+    {
+        uint32_t actual = crc32c_append_parallel(1, input, PARALLEL_BUFFER - threads, threads);
+        uint32_t tail = crc32c_append(0, input + PARALLEL_BUFFER - threads, threads);
+        if (crc32c_combine(actual, tail, threads) != expected)
+        {
+            printf("CRC mismatch between append and append_parallel with %d threads\n", threads);
+            exit(1);
+        }
+    }
+}
+
+#define FILE_TEMP "crc32c-file.tmp"
+#define FILE_SIZE (PARALLEL_BUFFER + 12345)
+
+/* Writes file larger than one crc32c_file window and compares crc32c_file with reading through a buffer while the file is in page cache. */
+static void check_file(buffer input)
+{
+    uint8_t *data = new uint8_t[FILE_SIZE];
+    for (int i = 0; i < FILE_SIZE; ++i)
+        data[i] = input[i % PARALLEL_BUFFER];
+    FILE *file = fopen(FILE_TEMP, "wb");
+    if (!file || fwrite(data, 1, FILE_SIZE, file) != FILE_SIZE || fclose(file) != 0)
+    {
+        printf("Cannot write %s\n", FILE_TEMP);
+        exit(1);
+    }
+    uint32_t expected = crc32c_append(0, data, FILE_SIZE);
+    uint32_t actual = 0;
+    if (crc32c_file(FILE_TEMP, &actual) != 0 || actual != expected)
+    {
+        printf("CRC mismatch between append and file: %x vs %x\n", expected, actual);
+        exit(1);
+    }
+    uint32_t missing;
+    if (crc32c_file(FILE_TEMP ".missing", &missing) == 0)
+    {
+        printf("crc32c_file succeeded on missing file\n");
+        exit(1);
+    }
+
+    uint64_t startTime = GetTicks();
+    uint64_t totalBytes = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        crc32c_file(FILE_TEMP, &actual);
+        totalBytes += FILE_SIZE;
+    }
+    printf("file mmap: %.1f GB/s\n", totalBytes * 1000.0 / (GetTicks() - startTime) / 1024 / 1024 / 1024);
+    startTime = GetTicks();
+    totalBytes = 0;
+    while (GetTicks() - startTime < 500)
+    {
+        file = fopen(FILE_TEMP, "rb");
+        uint32_t crc = 0;
+        size_t count;
+        while ((count = fread(data, 1, 4 * 1024 * 1024, file)) > 0)
+            crc = crc32c_append(crc, data, count);
+        fclose(file);
+        totalBytes += FILE_SIZE;
+    }
+    printf("file read: %.1f GB/s\n", totalBytes * 1000.0 / (GetTicks() - startTime) / 1024 / 1024 / 1024);
+    remove(FILE_TEMP);
+    delete[] data;
+}
+
+static void check_copy(buffer input, int *offsets, int *lengths)
+{
+    uint8_t *output = new uint8_t[TEST_BUFFER + 64];
+    for (int i = 0; i < TEST_SLICES / 1000; ++i)
+    {
+        uint32_t expected = crc32c_append_sw(i, input + offsets[i], lengths[i]);
+        /* misalign destination independently of the source */
+        uint8_t *target = output + i % 61;
+        uint32_t actual = (i & 1 ? crc32c_copy_nt : crc32c_copy)(i, target, input + offsets[i], lengths[i]);
+        if (actual != expected || memcmp(target, input + offsets[i], lengths[i]) != 0)
+        {
+            printf("Copy mismatch at offset %d: %x vs %x\n", i, expected, actual);
+            exit(1);
+        }
+    }
+    delete[] output;
+}
+
+/* Compares fused copy with memcpy followed by crc over sizes that fit in L1, L2, and none of the caches. */
+static void benchmark_copy(buffer input)
+{
+    static const int sizes[] = { 4096, 65536, 16 * 1024 * 1024 };
+    uint8_t *output = new uint8_t[16 * 1024 * 1024];
+    for (int size : sizes)
+    {
+        const char *names[] = { "memcpy+hw", "copy", "copy_nt" };
+        for (int mode = 0; mode < 3; ++mode)
+        {
+            if (mode == 0 && !crc32c_hw_available())
+                continue;
+            uint32_t crc = 0;
+            uint64_t startTime = GetTicks();
+            uint64_t totalBytes = 0;
+            while (GetTicks() - startTime < 300)
+            {
+                for (int i = 0; i < 16; ++i)
+                {
+                    if (mode == 0)
+                    {
+                        memcpy(output, input, size);
+                        crc = crc32c_append_hw(crc, output, size);
+                    }
+                    else if (mode == 1)
+                        crc = crc32c_copy(crc, output, input, size);
+                    else
+                        crc = crc32c_copy_nt(crc, output, input, size);
+                }
+                totalBytes += 16 * (uint64_t)size;
+            }
+            printf("%s %dKB: %.1f GB/s\n", names[mode], size / 1024, totalBytes * 1000.0 / (GetTicks() - startTime) / 1024 / 1024 / 1024);
+        }
+    }
+    delete[] output;
+}
+
+static void benchmark_parallel(buffer input)
+{
+    int processors = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int threads = 1; ; threads = std::min(2 * threads, processors))
+    {
+        uint64_t startTime = GetTicks();
+        uint64_t totalBytes = 0;
+        uint32_t crc = 0;
+        while (GetTicks() - startTime < 500)
+        {
+            crc = crc32c_append_parallel(crc, input, PARALLEL_BUFFER, threads);
+            totalBytes += PARALLEL_BUFFER;
+        }
+        double throughput = totalBytes * 1000.0 / (GetTicks() - startTime);
+        printf("parallel %d: %.1f GB/s\n", threads, throughput / 1024 / 1024 / 1024);
+        if (threads == processors)
+            break;
+    }
+}
+
 void crc32c_unittest()
 {
     std::random_device rd;
@@ -162,18 +735,81 @@ void crc32c_unittest()
     compare_crcs("trivial", crcsTrivial, "adler_table", crcsAdlerTable, std::min(iterationsTrivial, iterationsAdlerTable));
     int iterationsTable = benchmark("table", crc32c_append_sw, input, offsets, lengths, crcsTable);
     compare_crcs("adler_table", crcsAdlerTable, "table", crcsTable, std::min(iterationsAdlerTable, iterationsTable));
+    uint32_t *crcsBraided = new uint32_t[TEST_SLICES];
+    int iterationsBraided = benchmark("braided", crc32c_append_braided, input, offsets, lengths, crcsBraided);
+    compare_crcs("table", crcsTable, "braided", crcsBraided, std::min(iterationsTable, iterationsBraided));
     if (crc32c_hw_available())
     {
         int iterationsHw = benchmark("hw", crc32c_append_hw, input, offsets, lengths, crcsHw);
         compare_crcs("table", crcsTable, "hw", crcsHw, std::min(iterationsTable, iterationsHw));
+        if (crc32c_clmul_available())
+        {
+            uint32_t *crcsHybrid = new uint32_t[TEST_SLICES];
+            int iterationsHybrid = benchmark("hybrid", crc32c_append_hybrid, input, offsets, lengths, crcsHybrid);
+            compare_crcs("table", crcsTable, "hybrid", crcsHybrid, std::min(iterationsTable, iterationsHybrid));
+        }
     }
     else
         printf("HW doesn't have crc instruction\n");
+    if (crc32c_clmul_available())
+    {
+        uint32_t *crcsClmul = new uint32_t[TEST_SLICES];
+        int iterationsClmul = benchmark("clmul", crc32c_append_clmul, input, offsets, lengths, crcsClmul);
+        compare_crcs("table", crcsTable, "clmul", crcsClmul, std::min(iterationsTable, iterationsClmul));
+    }
+    else
+        printf("HW doesn't have carry-less multiplication instruction\n");
+    if (crc32c_vpclmul_available())
+    {
+        uint32_t *crcsVpclmul = new uint32_t[TEST_SLICES];
+        int iterationsVpclmul = benchmark("vpclmul", crc32c_append_vpclmul, input, offsets, lengths, crcsVpclmul);
+        compare_crcs("table", crcsTable, "vpclmul", crcsVpclmul, std::min(iterationsTable, iterationsVpclmul));
+    }
+    else
+        printf("HW doesn't have AVX-512 carry-less multiplication instruction\n");
     benchmark("auto", crc32c_append, input, offsets, lengths, crcsHw);
+    check_sliced(input, offsets, lengths);
+    benchmark_footprint("none", NULL, input);
+    benchmark_footprint("sw4", crc32c_append_sw4, input);
+    benchmark_footprint("sw8", crc32c_append_sw8, input);
+    benchmark_footprint("sw16", crc32c_append_sw16, input);
+    check_calibration();
+    uint32_t *crcsCalibrated = new uint32_t[TEST_SLICES];
+    int iterationsCalibrated = benchmark("calibrated", crc32c_append_calibrated, input, offsets, lengths, crcsCalibrated);
+    compare_crcs("table", crcsTable, "calibrated", crcsCalibrated, std::min(iterationsTable, iterationsCalibrated));
+    check_combine(input, offsets, lengths);
+    benchmark_combine(lengths);
+    check_update(input, offsets, lengths);
+    benchmark_update(input);
+    if (crc32c_hw_available())
+        benchmark_latency("hw", crc32c_append_hw, input);
+    benchmark_latency("auto", crc32c_append, input);
+    benchmark_latency("calibrated", crc32c_append_calibrated, input);
+    benchmark_batch(input);
+    if (crc32c_hw_available())
+        check_inline(input);
+    check_constexpr(input, offsets, lengths);
+    check_stream(input, offsets, lengths);
+    benchmark_stream(input);
+    check_appendv(input, offsets, lengths);
+    benchmark_appendv(input);
+    check_zeros(lengths);
+    benchmark_zeros();
+    uint8_t *large = new uint8_t[PARALLEL_BUFFER];
+    for (int i = 0; i < PARALLEL_BUFFER; ++i)
+        large[i] = input[i % TEST_BUFFER] ^ (uint8_t)(i >> 16);
+    check_parallel(large);
+    check_file(large);
+    check_copy(input, offsets, lengths);
+    benchmark_copy(large);
+    benchmark_parallel(large);
+    delete[] large;
 }
 
 int main(int argc, char* argv[])
 {
+    /* asks the library, which might be built with other flags than this file */
+    printf("isa: %s\n", crc32c_build_isa());
     crc32c_unittest();
     return 0;
 }
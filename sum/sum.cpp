@@ -0,0 +1,325 @@
+// sum.cpp : crc32c-sum command line tool, which prints or checks CRC-32C of files like sha256sum.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+
+#include "crc32c.h"
+#include "uring.h"
+
+/* Large reads keep the disk busy with few syscalls. Alignment lets the kernel copy whole pages. */
+#define READ_BUFFER (4 * 1024 * 1024)
+#define READ_ALIGNMENT 4096
+
+/* io_uring engine keeps this many reads of this size in flight. */
+#define URING_DEPTH 16
+#define URING_BUFFER (1024 * 1024)
+
+struct options
+{
+    bool mmap;
+    bool uring;
+    bool direct;
+    unsigned queue_depth;
+};
+
+static options settings = { false, false, false, URING_DEPTH };
+
+struct job
+{
+    std::string path;
+    uint32_t expected;
+    bool done;
+    bool ok;
+    uint32_t crc;
+    std::string error;
+};
+
+static bool hash_fd(int fd, uint8_t *buffer, uint32_t *crc, std::string *error)
+{
+    uint32_t result = 0;
+    for (;;)
+    {
+        ssize_t count = read(fd, buffer, READ_BUFFER);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            *error = strerror(errno);
+            return false;
+        }
+        if (count == 0)
+            break;
+        result = crc32c_append(result, buffer, (size_t)count);
+    }
+    *crc = result;
+    return true;
+}
+
+static bool hash_file(const std::string &path, uint8_t *buffer, uring_reader *reader, uint32_t *crc, std::string *error)
+{
+    if (path == "-")
+        return hash_fd(0, buffer, crc, error);
+    /* reader that lost its ring is replaced by read() for the remaining files */
+    if (reader && !reader->available())
+        reader = NULL;
+    int fd = -1;
+#ifdef O_DIRECT
+    /* some filesystems, e.g. tmpfs, don't support O_DIRECT */
+    if (settings.direct && reader)
+        fd = open(path.c_str(), O_RDONLY | O_DIRECT);
+#endif
+    if (fd < 0)
+        fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        *error = strerror(errno);
+        return false;
+    }
+    struct stat info;
+    bool regular = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+    bool ok;
+    /* io_uring and mmap engines need to know file size in advance, so pipes and devices are read sequentially */
+    if (reader && regular)
+        ok = reader->hash(fd, crc, error);
+    else if (settings.mmap && regular)
+    {
+        ok = crc32c_file(path.c_str(), crc) == 0;
+        if (!ok)
+            *error = strerror(errno);
+    }
+    else
+    {
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        ok = hash_fd(fd, buffer, crc, error);
+    }
+    close(fd);
+    return ok;
+}
+
+/* Workers take files in order, so results near the head of the list are ready first and output can start early. */
+class pool
+{
+public:
+    pool(std::vector<job> &jobs, int threads) : jobs(jobs), next(0)
+    {
+        for (int i = 0; i < threads; ++i)
+            workers.emplace_back([this] { work(); });
+    }
+
+    ~pool()
+    {
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    job &wait(size_t index)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return jobs[index].done; });
+        return jobs[index];
+    }
+
+private:
+    std::vector<job> &jobs;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next;
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    void work()
+    {
+        void *buffer;
+        if (posix_memalign(&buffer, READ_ALIGNMENT, READ_BUFFER) != 0)
+        {
+            fprintf(stderr, "crc32c-sum: out of memory\n");
+            exit(2);
+        }
+        /* the ring is only set up for the uring engine, which falls back to read() when io_uring is not available */
+        std::unique_ptr<uring_reader> reader;
+        if (settings.uring)
+            reader.reset(new uring_reader(settings.queue_depth, URING_BUFFER));
+        uring_reader *engine = reader && reader->available() ? reader.get() : NULL;
+        for (size_t index; (index = next++) < jobs.size(); )
+        {
+            uint32_t crc = 0;
+            std::string error;
+            bool ok = hash_file(jobs[index].path, (uint8_t *)buffer, engine, &crc, &error);
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs[index].ok = ok;
+            jobs[index].crc = crc;
+            jobs[index].error = error;
+            jobs[index].done = true;
+            finished.notify_all();
+        }
+        free(buffer);
+    }
+};
+
+static void usage(FILE *stream)
+{
+    fprintf(stream,
+        "Usage: crc32c-sum [OPTION]... [FILE]...\n"
+        "Print or check CRC-32C (Castagnoli) checksums.\n"
+        "With no FILE, or when FILE is -, read standard input.\n"
+        "\n"
+        "  -c, --check     read checksums from the FILEs and check them\n"
+        "  -j, --jobs N    hash up to N files in parallel (default: number of processors)\n"
+        "      --engine E  read files with 'read' (default), 'mmap', or 'uring' (Linux io_uring)\n"
+        "      --queue-depth N\n"
+        "                  number of 1MB reads the uring engine keeps in flight (default: 16)\n"
+        "      --direct    bypass page cache with O_DIRECT in the uring engine where supported\n"
+        "  -h, --help      display this help and exit\n");
+}
+
+/* Parses manifest lines in the format printed by this tool: eight hex digits, two spaces (or space and asterisk), and file name. */
+static bool read_manifest(const char *path, std::vector<job> &jobs, int *malformed)
+{
+    FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "crc32c-sum: %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    char line[4096 + 16];
+    while (fgets(line, sizeof(line), file))
+    {
+        size_t length = strlen(line);
+        while (length && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = 0;
+        if (!length)
+            continue;
+        char *end;
+        unsigned long crc = strtoul(line, &end, 16);
+        if (end != line + 8 || end[0] != ' ' || (end[1] != ' ' && end[1] != '*') || !end[2])
+        {
+            ++*malformed;
+            continue;
+        }
+        job entry = job();
+        entry.path = end + 2;
+        entry.expected = (uint32_t)crc;
+        jobs.push_back(entry);
+    }
+    if (file != stdin)
+        fclose(file);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    bool check = false;
+    int threads = (int)std::thread::hardware_concurrency();
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-c" || arg == "--check")
+            check = true;
+        else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (arg == "--engine" && i + 1 < argc)
+        {
+            std::string engine = argv[++i];
+            if (engine != "read" && engine != "mmap" && engine != "uring")
+            {
+                usage(stderr);
+                return 2;
+            }
+            settings.mmap = engine == "mmap";
+            settings.uring = engine == "uring";
+        }
+        else if (arg == "--queue-depth" && i + 1 < argc)
+            settings.queue_depth = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (arg == "--direct")
+            settings.direct = true;
+        else if (arg == "-h" || arg == "--help")
+        {
+            usage(stdout);
+            return 0;
+        }
+        else if (arg == "--")
+        {
+            files.insert(files.end(), argv + i + 1, argv + argc);
+            break;
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            usage(stderr);
+            return 2;
+        }
+        else
+            files.push_back(arg);
+    }
+    if (files.empty())
+        files.push_back("-");
+    if (threads <= 0)
+        threads = 1;
+
+    int status = 0;
+    int malformed = 0;
+    std::vector<job> jobs;
+    if (check)
+    {
+        for (auto &manifest : files)
+            if (!read_manifest(manifest.c_str(), jobs, &malformed))
+                status = 1;
+    }
+    else
+    {
+        for (auto &path : files)
+        {
+            job entry = job();
+            entry.path = path;
+            jobs.push_back(entry);
+        }
+    }
+
+    pool workers(jobs, std::min<int>(threads, (int)std::max<size_t>(jobs.size(), 1)));
+    int failed = 0;
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        job &result = workers.wait(i);
+        if (!result.ok)
+        {
+            fprintf(stderr, "crc32c-sum: %s: %s\n", result.path.c_str(), result.error.c_str());
+            if (check)
+                printf("%s: FAILED open or read\n", result.path.c_str());
+            status = 1;
+        }
+        else if (!check)
+            printf("%08x  %s\n", result.crc, result.path.c_str());
+        else if (result.crc == result.expected)
+            printf("%s: OK\n", result.path.c_str());
+        else
+        {
+            printf("%s: FAILED\n", result.path.c_str());
+            ++failed;
+            status = 1;
+        }
+    }
+    if (malformed)
+    {
+        fprintf(stderr, "crc32c-sum: WARNING: %d line%s improperly formatted\n", malformed, malformed == 1 ? " is" : "s are");
+        status = 1;
+    }
+    if (failed)
+        fprintf(stderr, "crc32c-sum: WARNING: %d computed checksum%s did NOT match\n", failed, failed == 1 ? "" : "s");
+    fflush(stdout);
+    return status;
+}
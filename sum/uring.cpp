@@ -0,0 +1,225 @@
+// uring.cpp : io_uring file reader for crc32c-sum. Talks to the kernel with raw syscalls, so liburing is not needed.
+//
+
+#include "uring.h"
+#include "crc32c.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SUM_URING
+#endif
+#endif
+
+#ifdef SUM_URING
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+uring_reader::uring_reader(unsigned queue_depth, size_t buffer_size)
+    : ring(-1), depth(queue_depth), buffer_size(buffer_size), fixed(false), buffers(NULL),
+    sq_ring(MAP_FAILED), cq_ring(MAP_FAILED), sqes(MAP_FAILED)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, depth, &params);
+    if (fd < 0)
+        return;
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        sq_ring_size = cq_ring_size = sq_ring_size > cq_ring_size ? sq_ring_size : cq_ring_size;
+    sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED)
+    {
+        close(fd);
+        return;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        cq_ring = sq_ring;
+    else
+        cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    void *memory = NULL;
+    if (cq_ring == MAP_FAILED || sqes == MAP_FAILED || posix_memalign(&memory, 4096, depth * buffer_size) != 0)
+    {
+        close(fd);
+        return;
+    }
+    buffers = (uint8_t *)memory;
+
+    uint8_t *sq = (uint8_t *)sq_ring;
+    uint8_t *cq = (uint8_t *)cq_ring;
+    sq_head = (unsigned *)(sq + params.sq_off.head);
+    sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    sq_array = (unsigned *)(sq + params.sq_off.array);
+    cq_head = (unsigned *)(cq + params.cq_off.head);
+    cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+
+    /* registered buffers save page pinning on every read, but they count against RLIMIT_MEMLOCK */
+    std::vector<struct iovec> iovecs(depth);
+    for (unsigned i = 0; i < depth; ++i)
+    {
+        iovecs[i].iov_base = buffers + i * buffer_size;
+        iovecs[i].iov_len = buffer_size;
+    }
+    fixed = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iovecs.data(), depth) == 0;
+    ring = fd;
+}
+
+uring_reader::~uring_reader()
+{
+    close_ring();
+    free(buffers);
+}
+
+void uring_reader::close_ring()
+{
+    if (sqes != MAP_FAILED)
+        munmap(sqes, sqes_size);
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+        munmap(cq_ring, cq_ring_size);
+    if (sq_ring != MAP_FAILED)
+        munmap(sq_ring, sq_ring_size);
+    if (ring >= 0)
+        close(ring);
+    sqes = cq_ring = sq_ring = MAP_FAILED;
+    ring = -1;
+}
+
+void uring_reader::submit_read(int fd, unsigned slot, uint64_t offset, size_t length)
+{
+    unsigned tail = *sq_tail;
+    unsigned index = tail & *sq_mask;
+    struct io_uring_sqe *sqe = (struct io_uring_sqe *)sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = (uint64_t)(uintptr_t)(buffers + slot * buffer_size);
+    sqe->len = (uint32_t)length;
+    sqe->buf_index = (uint16_t)slot;
+    sqe->user_data = slot;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+bool uring_reader::hash(int fd, uint32_t *crc, std::string *error)
+{
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        *error = strerror(errno);
+        return false;
+    }
+    uint64_t size = (uint64_t)info.st_size;
+    /* every slot reads one aligned block of the file, of which done bytes are already checksummed */
+    std::vector<uint64_t> offsets(depth);
+    std::vector<size_t> lengths(depth);
+    std::vector<size_t> done(depth);
+    std::vector<unsigned> idle;
+    for (unsigned slot = depth; slot > 0; --slot)
+        idle.push_back(slot - 1);
+    uint64_t next = 0;
+    unsigned inflight = 0;
+    unsigned submitted = 0;
+    uint32_t result = 0;
+    int failure = 0;
+
+    while (inflight || (next < size && !failure))
+    {
+        /* keep the queue full */
+        while (!idle.empty() && next < size && !failure)
+        {
+            unsigned slot = idle.back();
+            idle.pop_back();
+            offsets[slot] = next;
+            lengths[slot] = size - next < buffer_size ? (size_t)(size - next) : buffer_size;
+            done[slot] = 0;
+            /* full buffer is requested even at the end of the file, so that O_DIRECT reads stay aligned */
+            submit_read(fd, slot, next, buffer_size);
+            next += lengths[slot];
+            ++submitted;
+            ++inflight;
+        }
+        int entered = (int)syscall(__NR_io_uring_enter, ring, submitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (entered < 0)
+        {
+            /* EAGAIN and EBUSY mean the kernel is short of request memory or completion space, which frees up as completions are reaped */
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            {
+                /* in-flight reads cannot be waited for, so the ring is closed to cancel them and
+                   the buffers are leaked, because cancelled reads might still be writing into them */
+                *error = strerror(errno);
+                close_ring();
+                buffers = NULL;
+                return false;
+            }
+            entered = 0;
+        }
+        submitted -= (unsigned)entered;
+
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            struct io_uring_cqe *cqe = (struct io_uring_cqe *)cqes + (head & *cq_mask);
+            unsigned slot = (unsigned)cqe->user_data;
+            int count = cqe->res;
+            --inflight;
+            if (count > 0 && (size_t)count > lengths[slot])
+                count = (int)lengths[slot];
+            if (count < 0 || (size_t)count <= done[slot])
+            {
+                /* read that brings no new data means the file got shorter since fstat */
+                if (!failure)
+                    failure = count < 0 ? -count : -1;
+                idle.push_back(slot);
+                continue;
+            }
+            /* partial crc starts from zero and it is shifted over all the bytes that follow it in the file */
+            uint32_t part = crc32c_append(0, buffers + slot * buffer_size + done[slot], count - done[slot]);
+            result ^= crc32c_combine(part, 0, size - offsets[slot] - count);
+            done[slot] = count;
+            if ((size_t)count < lengths[slot] && !failure)
+            {
+                /* short read, read the block again from its aligned start, because O_DIRECT
+                   would reject an offset in the middle of it */
+                submit_read(fd, slot, offsets[slot], buffer_size);
+                ++submitted;
+                ++inflight;
+            }
+            else
+                idle.push_back(slot);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+    if (failure)
+    {
+        *error = failure < 0 ? "file shrank while reading" : strerror(failure);
+        return false;
+    }
+    *crc = result;
+    return true;
+}
+#else
+uring_reader::uring_reader(unsigned queue_depth, size_t buffer_size) : ring(-1), depth(queue_depth), buffer_size(buffer_size) {}
+uring_reader::~uring_reader() {}
+bool uring_reader::hash(int, uint32_t *, std::string *error)
+{
+    *error = "io_uring is not supported";
+    return false;
+}
+#endif
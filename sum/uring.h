@@ -0,0 +1,52 @@
+// uring.h : io_uring file reader for crc32c-sum.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/*
+    Reads regular files through io_uring with several reads in flight. Every buffer is checksummed
+    as soon as its read completes and out-of-order partial CRCs are combined by shifting them over
+    the rest of the file. Buffers are registered with the kernel when memory lock limits allow it.
+    One reader is used by one thread at a time. Linux only, unavailable elsewhere.
+*/
+class uring_reader
+{
+public:
+    uring_reader(unsigned queue_depth, size_t buffer_size);
+    ~uring_reader();
+
+    /* False if the kernel doesn't support io_uring or it is blocked, e.g. by seccomp in containers,
+       and after the ring failed and had to be closed. */
+    bool available() const { return ring >= 0; }
+
+    /* Computes CRC-32C of regular file. Offsets are multiples of buffer size, so the file can be opened with O_DIRECT. */
+    bool hash(int fd, uint32_t *crc, std::string *error);
+
+private:
+    int ring;
+    unsigned depth;
+    size_t buffer_size;
+    bool fixed;
+    uint8_t *buffers;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    void *sqes;
+    size_t sqes_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    void *cqes;
+
+    void submit_read(int fd, unsigned slot, uint64_t offset, size_t length);
+    void close_ring();
+};